@@ -0,0 +1,234 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <array>
+#include <filesystem>
+#include <random>
+#include <string>
+
+#include "alloc_counter.h"
+#include "application.h"
+#include "collision_detector.h"
+#include "json_loader.h"
+#include "loot_generator.h"
+#include "model.h"
+
+using namespace std::literals;
+
+namespace {
+
+// Зерно общее для всех случаев, чтобы прогоны можно было сравнивать между собой
+constexpr std::uint64_t SEED = 42;
+
+// Путь к data/config.json задается при сборке (см. CMakeLists.txt)
+model::Game LoadConfigGame() {
+    return json_loader::LoadGame(GAME_CONFIG_PATH);
+}
+
+collision_detector::ItemGatherer MakeGatherProvider(int gatherers, int items, std::mt19937_64& random) {
+    std::uniform_real_distribution<double> coord(0.0, 100.0);
+    std::uniform_real_distribution<double> step(-1.0, 1.0);
+
+    collision_detector::ItemGatherer provider;
+    for (int i = 0; i < items; ++i) {
+        provider.AddItem({{coord(random), coord(random)}, 0.0});
+    }
+    for (int i = 0; i < gatherers; ++i) {
+        const geom::Point2D start{coord(random), coord(random)};
+        provider.AddGatherer({start, {start.x + step(random), start.y + step(random)}, 0.6});
+    }
+    return provider;
+}
+
+// Собаки в случайных точках дорог карты
+std::vector<model::Dog> MakeDogs(const model::Map& map, int count, std::mt19937_64& random) {
+    std::vector<model::Dog> dogs;
+    dogs.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        auto& dog = dogs.emplace_back(i, "dog"s + std::to_string(i));
+        dog.SetMapSpeed(map.GetSpeed());
+        dog.SetBagCapacity(map.GetCapacity());
+        dog.SetCords(map.GetRandomCordsOnMap(random));
+    }
+    return dogs;
+}
+
+const std::string& RandomDirection(std::mt19937_64& random) {
+    static const std::array<std::string, 4> directions{"L"s, "R"s, "U"s, "D"s};
+    return directions[std::uniform_int_distribution<std::size_t>(0, directions.size() - 1)(random)];
+}
+
+// Собаки упираются в края дорог и останавливаются, поэтому направления
+// раздаются заново перед каждым замером
+template <typename DogRange>
+void TurnDogs(DogRange& dogs, std::mt19937_64& random) {
+    for (auto& dog : dogs) {
+        dog.SetDirection(RandomDirection(random));
+    }
+}
+
+void TurnDogRefs(const std::vector<model::DogRef>& dogs, std::mt19937_64& random) {
+    for (const auto& dog : dogs) {
+        dog.Get()->SetDirection(RandomDirection(random));
+    }
+}
+
+} // namespace
+
+TEST_CASE("FindGatherEvents", "[collision][benchmark]") {
+    std::mt19937_64 random(SEED);
+
+    for (int gatherers : {10, 100, 1000}) {
+        for (int items : {10, 100, 1000}) {
+            const auto provider = MakeGatherProvider(gatherers, items, random);
+
+            BENCHMARK("gatherers=" + std::to_string(gatherers) + " items=" + std::to_string(items)) {
+                return collision_detector::FindGatherEvents(provider);
+            };
+        }
+    }
+}
+
+TEST_CASE("Dog::UpdateTickState on config maps", "[model][benchmark]") {
+    constexpr int DOGS = 1000;
+    constexpr int TICK = 50;
+
+    const auto game = LoadConfigGame();
+    std::mt19937_64 random(SEED);
+
+    for (const auto& map_shared : game.GetMaps()) {
+        const auto& map = *map_shared;
+        auto dogs = MakeDogs(map, DOGS, random);
+
+        BENCHMARK_ADVANCED("1000 dogs, map " + *map.GetId())(Catch::Benchmark::Chronometer meter) {
+            TurnDogs(dogs, random);
+            meter.measure([&] {
+                for (auto& dog : dogs) {
+                    dog.UpdateTickState(TICK, map_shared);
+                }
+            });
+        };
+    }
+}
+
+TEST_CASE("GameSession::UpdateTickState", "[model][benchmark]") {
+    constexpr int TICK = 50;
+    constexpr int RETIRE_TIME = 1'000'000'000;
+
+    const auto game = LoadConfigGame();
+    const auto& map = *game.GetMaps().front();
+    std::mt19937_64 random(SEED);
+
+    for (int count : {100, 1'000, 10'000}) {
+        auto session = std::make_shared<model::GameSession>(0, game.GetMaps().front());
+        for (auto& dog : MakeDogs(map, count, random)) {
+            session->AddDog(std::move(dog));
+        }
+
+        auto loot_generator = std::make_shared<loot_gen::LootGenerator>(
+            game.GetGenerator()->GetBaseInterval(), game.GetGenerator()->GetProbability(),
+            [&random] { return std::uniform_real_distribution<double>(0.0, 1.0)(random); });
+
+        model::TickArena arena;
+
+        BENCHMARK_ADVANCED(std::to_string(count) + " dogs")(Catch::Benchmark::Chronometer meter) {
+            TurnDogs(session->GetDogs(), random);
+            meter.measure([&] {
+                arena.Reset();
+                session->UpdateTickState(TICK, loot_generator, nullptr, RETIRE_TIME, random, nullptr, arena.Resource());
+            });
+        };
+    }
+}
+
+// Выделения памяти в тике игры после разогрева. Имеет смысл только в сборке
+// с -DGAME_COUNT_ALLOCATIONS=ON, где operator new считает выделения
+TEST_CASE("Game::UpdateTickState allocations", "[model][alloc]") {
+    if constexpr (!alloc_counter::ENABLED) {
+        SKIP("build with -DGAME_COUNT_ALLOCATIONS=ON to count allocations");
+    }
+
+    constexpr int DOGS = 1000;
+    constexpr int TICK = 50;
+    constexpr int WARMUP_TICKS = 200;
+    constexpr int TICKS = 200;
+
+    auto game = LoadConfigGame();
+    game.SetRetireTime(1'000'000'000);
+    std::mt19937_64 random(SEED);
+
+    std::vector<model::DogRef> dogs;
+    for (int i = 0; i < DOGS; ++i) {
+        const auto& map = *game.GetMaps()[i % game.GetMaps().size()];
+        auto player = Players::AddPlayer(game, "dog"s + std::to_string(i), *map.GetId());
+        dogs.push_back({player->GetSession(), player->GetDog()});
+    }
+
+    // направления раздаются между тиками, вне замера
+    for (int tick = 0; tick < WARMUP_TICKS; ++tick) {
+        TurnDogRefs(dogs, random);
+        game.UpdateTickState(TICK, random());
+    }
+
+    alloc_counter::Counts total;
+    for (int tick = 0; tick < TICKS; ++tick) {
+        TurnDogRefs(dogs, random);
+        const auto before = alloc_counter::ThreadCounts();
+        game.UpdateTickState(TICK, random());
+        const auto delta = alloc_counter::ThreadCounts() - before;
+        total.allocations += delta.allocations;
+        total.bytes += delta.bytes;
+    }
+
+    UNSCOPED_INFO("allocations per tick: " << static_cast<double>(total.allocations) / TICKS
+                  << ", bytes per tick: " << static_cast<double>(total.bytes) / TICKS);
+    CHECK(total.allocations == 0);
+}
+
+TEST_CASE("LootGenerator::Generate", "[loot][benchmark]") {
+    std::mt19937_64 random(SEED);
+    loot_gen::LootGenerator generator(5s, 0.5, [&random] {
+        return std::uniform_real_distribution<double>(0.0, 1.0)(random);
+    });
+
+    BENCHMARK("Generate") {
+        return generator.Generate(50ms, 10, 100);
+    };
+}
+
+TEST_CASE("Game::SaveState / LoadState on config maps, 10k players", "[state][benchmark]") {
+    namespace fs = std::filesystem;
+
+    constexpr int PLAYERS = 10'000;
+
+    const fs::path path = fs::temp_directory_path() / "game_bench_game_state.bin";
+    Players::SetAllPlayers({});
+
+    auto game = LoadConfigGame();
+    game.SetSaveFile(path.string());
+    game.SetRandomizeSpawnPoint(true);
+    const auto& maps = game.GetMaps();
+    for (int i = 0; i < PLAYERS; ++i) {
+        Players::AddPlayer(game, "dog"s + std::to_string(i), *maps[i % maps.size()]->GetId());
+    }
+    game.SaveState();
+
+    BENCHMARK("SaveState") {
+        game.SaveState();
+    };
+
+    BENCHMARK("LoadState") {
+        auto loaded = LoadConfigGame();
+        loaded.SetSaveFile(path.string());
+        loaded.LoadState();
+        return loaded.GetMaps().size();
+    };
+
+    fs::remove(path);
+}
+
+TEST_CASE("TokenGenerator::GetToken", "[application][benchmark]") {
+    BENCHMARK("GetToken") {
+        return TokenGenerator::GetToken();
+    };
+}
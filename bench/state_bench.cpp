@@ -0,0 +1,144 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+#include "state_format.h"
+#include "state_saver.h"
+
+using namespace std::literals;
+
+namespace {
+
+constexpr int DOGS = 100'000;
+constexpr int LOOTS_ON_MAP = 20'000;
+constexpr int SESSIONS = 10;
+
+// Мир из DOGS собак с полными рюкзаками, разложенных по SESSIONS сессиям
+serialization::GameStateRepr MakeState() {
+    serialization::GameStateRepr state;
+    state.dogs.reserve(DOGS);
+    state.players.reserve(DOGS);
+
+    auto map = std::make_shared<model::Map>(model::Map::Id("map1"s), "Map 1"s);
+    int loot_id = 0;
+
+    for (int s = 0; s < SESSIONS; ++s) {
+        auto session = std::make_shared<model::GameSession>(s, map);
+
+        model::Loots loots;
+        for (int i = 0; i < LOOTS_ON_MAP / SESSIONS; ++i) {
+            loots.emplace_back(loot_id++, i % 3, model::Coords{i * 0.5, i * 0.25});
+            state.loots.emplace_back(loots.back());
+        }
+        session->AddLoots(loots);
+
+        session->GetDogs().Reserve(DOGS / SESSIONS);
+        for (int i = 0; i < DOGS / SESSIONS; ++i) {
+            const int id = s * (DOGS / SESSIONS) + i;
+            model::Dog dog(id, "dog"s + std::to_string(id));
+            dog.SetCords({i * 0.1, i * 0.2});
+            dog.SetScore(i);
+            for (int j = 0; j < 3; ++j) {
+                model::Loot loot(loot_id++, j, dog.GetCords());
+                dog.TakeLoot(loot);
+                state.loots.emplace_back(loot);
+            }
+            state.dogs.emplace_back(dog);
+            const auto handle = session->AddDog(std::move(dog));
+            state.players.emplace_back(std::make_shared<Player>(id, TokenGenerator::GetToken(), handle, id, session));
+        }
+        state.sessions.emplace_back(session);
+    }
+
+    return state;
+}
+
+std::string EncodeText(const serialization::GameStateRepr& state) {
+    std::ostringstream out;
+    boost::archive::text_oarchive oa(out);
+    state.Write(oa);
+    return std::move(out).str();
+}
+
+} // namespace
+
+TEST_CASE("State file save and load, 100k dogs", "[state][benchmark]") {
+    namespace fs = std::filesystem;
+
+    const auto state = MakeState();
+    const auto binary = serialization::BinaryStateFormat::Encode(state);
+    const auto text = EncodeText(state);
+
+    const fs::path path = fs::temp_directory_path() / "game_bench_state.bin";
+    serialization::WriteState(state, path.string());
+
+    REQUIRE(serialization::BinaryStateFormat::Decode(binary).dogs.size() == DOGS);
+
+    BENCHMARK("binary encode") {
+        return serialization::BinaryStateFormat::Encode(state);
+    };
+
+    BENCHMARK("binary decode") {
+        return serialization::BinaryStateFormat::Decode(binary);
+    };
+
+    BENCHMARK("text archive encode") {
+        return EncodeText(state);
+    };
+
+    BENCHMARK("text archive decode") {
+        serialization::GameStateRepr result;
+        std::istringstream in(text);
+        boost::archive::text_iarchive ia(in);
+        result.Read(ia);
+        return result;
+    };
+
+    BENCHMARK("WriteState (encode + fsync + rename)") {
+        return serialization::WriteState(state, path.string());
+    };
+
+    BENCHMARK("ReadState") {
+        return serialization::ReadState(path.string());
+    };
+
+    fs::remove(path);
+}
+
+TEST_CASE("Game startup from a state file, 100k dogs", "[state][benchmark]") {
+    namespace fs = std::filesystem;
+
+    const auto state = MakeState();
+    const fs::path path = fs::temp_directory_path() / "game_bench_startup.bin";
+    serialization::WriteState(state, path.string());
+
+    const auto make_game = [] {
+        model::Game game;
+        game.AddMap(model::Map(model::Map::Id("map1"s), "Map 1"s));
+        return game;
+    };
+
+    {
+        auto game = make_game();
+        game.RestoreState(state);
+        REQUIRE(Players::Count() == DOGS);
+    }
+
+    BENCHMARK("RestoreState") {
+        auto game = make_game();
+        game.RestoreState(state);
+        return game.GetMaps().size();
+    };
+
+    BENCHMARK("LoadState (read + restore)") {
+        auto game = make_game();
+        game.SetSaveFile(path.string());
+        game.LoadState();
+        return game.GetMaps().size();
+    };
+
+    fs::remove(path);
+}
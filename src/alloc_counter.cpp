@@ -0,0 +1,111 @@
+#include "alloc_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace alloc_counter {
+
+namespace {
+
+// Тривиальный тип: счетчик доступен и во время создания и разрушения потока
+thread_local Counts thread_counts;
+
+} // namespace
+
+Counts ThreadCounts() noexcept {
+    return thread_counts;
+}
+
+}  // namespace alloc_counter
+
+#ifdef GAME_COUNT_ALLOCATIONS
+
+namespace {
+
+void* CountedAlloc(std::size_t size, std::size_t alignment) noexcept {
+    auto& counts = alloc_counter::thread_counts;
+    ++counts.allocations;
+    counts.bytes += size;
+
+    if (size == 0) {
+        size = 1;
+    }
+    if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        return std::malloc(size);
+    }
+    // aligned_alloc требует размер, кратный выравниванию
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void* CountedAllocOrThrow(std::size_t size, std::size_t alignment) {
+    for (;;) {
+        if (void* ptr = CountedAlloc(size, alignment)) {
+            return ptr;
+        }
+        auto handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    return CountedAllocOrThrow(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](std::size_t size) {
+    return CountedAllocOrThrow(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return CountedAllocOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return CountedAllocOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+#endif  // GAME_COUNT_ALLOCATIONS
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+namespace alloc_counter {
+
+/*
+ *  Подсчет выделений памяти в куче. В сборке с -DGAME_COUNT_ALLOCATIONS=ON
+ *  глобальные operator new заменены (alloc_counter.cpp) и считают выделения
+ *  каждого потока; тик раскладывает их по фазам в метрики
+ *  game_tick_phase_allocations_total и game_tick_phase_allocated_bytes_total.
+ *  Без опции счетчики всегда нулевые.
+ */
+#ifdef GAME_COUNT_ALLOCATIONS
+inline constexpr bool ENABLED = true;
+#else
+inline constexpr bool ENABLED = false;
+#endif
+
+struct Counts {
+    std::uint64_t allocations = 0;
+    std::uint64_t bytes = 0;
+
+    Counts operator-(const Counts& other) const noexcept {
+        return {allocations - other.allocations, bytes - other.bytes};
+    }
+};
+
+// Выделения памяти текущим потоком с начала его работы
+Counts ThreadCounts() noexcept;
+
+}  // namespace alloc_counter
@@ -1,8 +1,546 @@
 #include "api_handler.h"
+#include "metrics.h"
+#include "journal.h"
+#include "trace.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
 
 namespace api_handler {
 
-bool isValidHex32(const std::string& str) {
+namespace {
+
+// Конечные точки API
+enum class Endpoint {
+    MAPS,
+    MAP,
+    JOIN,
+    PLAYERS,
+    STATE,
+    ACTION,
+    TICK,
+    RECORDS
+};
+
+// Допустимые методы маршрута (битовая маска)
+enum Methods : unsigned {
+    METHOD_GET = 1,
+    METHOD_HEAD = 2,
+    METHOD_POST = 4,
+    METHOD_ANY = ~0u
+};
+
+struct Route {
+    std::string_view path;
+    Endpoint endpoint;
+    bool with_param;               // путь является префиксом, остаток передается в ApiRequest::param
+    unsigned methods;
+    std::string_view allow;        // значение заголовка Allow при неверном методе
+    std::string_view method_error; // текст ошибки при неверном методе
+    bool need_json;                // требуется Content-Type: application/json
+    bool need_auth;                // требуется Authorization: Bearer <token>
+    bool off_strand;               // при работе по таймеру обрабатывается вне strand игры
+                                   // (ставит команду в очередь или читает снимок сессии)
+};
+
+constexpr std::array ROUTES = {
+    Route{REQUEST_MAPS, Endpoint::MAPS, false, METHOD_ANY, "", "", false, false, false},
+    Route{REQUEST_STARTS_WITH_MAPS, Endpoint::MAP, true, METHOD_GET | METHOD_HEAD, "GET, HEAD", "Invalid method", false, false, false},
+    Route{REQUEST_JOIN, Endpoint::JOIN, false, METHOD_POST, "POST", "Only POST method is expected", false, false, false},
+    Route{REQUEST_PLAYERS, Endpoint::PLAYERS, false, METHOD_GET | METHOD_HEAD, "GET, HEAD", "Invalid method", false, true, true},
+    Route{REQUEST_STATE, Endpoint::STATE, false, METHOD_GET | METHOD_HEAD, "GET, HEAD", "Invalid method", false, true, true},
+    Route{REQUEST_ACTION, Endpoint::ACTION, false, METHOD_POST, "POST", "Invalid method", true, true, true},
+    Route{REQUEST_TICK, Endpoint::TICK, false, METHOD_POST, "POST", "Invalid method", true, false, false},
+    Route{REQUEST_RECORDS, Endpoint::RECORDS, false, METHOD_GET, "GET", "Invalid method", false, false, false},
+};
+
+// FNV-1a, вычисляется и во время компиляции, и во время выполнения
+constexpr std::uint64_t HashPath(std::string_view path) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (char c : path) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Хеш-таблица маршрутов с открытой адресацией, строится во время компиляции
+constexpr std::size_t ROUTE_INDEX_SIZE = 32;
+static_assert(ROUTE_INDEX_SIZE >= 2 * ROUTES.size(), "Route index is too dense");
+
+constexpr auto BuildRouteIndex() {
+    std::array<int, ROUTE_INDEX_SIZE> index{};
+    for (auto& slot : index) {
+        slot = -1;
+    }
+    for (std::size_t i = 0; i < ROUTES.size(); ++i) {
+        std::size_t slot = HashPath(ROUTES[i].path) % ROUTE_INDEX_SIZE;
+        while (index[slot] != -1) {
+            slot = (slot + 1) % ROUTE_INDEX_SIZE;
+        }
+        index[slot] = static_cast<int>(i);
+    }
+    return index;
+}
+
+constexpr auto ROUTE_INDEX = BuildRouteIndex();
+
+const Route* LookupRoute(std::string_view path) {
+    for (std::size_t slot = HashPath(path) % ROUTE_INDEX_SIZE; ROUTE_INDEX[slot] != -1; slot = (slot + 1) % ROUTE_INDEX_SIZE) {
+        const Route& route = ROUTES[ROUTE_INDEX[slot]];
+        if (route.path == path) {
+            return &route;
+        }
+    }
+    return nullptr;
+}
+
+// Точное совпадение пути, иначе маршрут с параметром, путь которого - префикс запроса.
+// Параметром становится весь остаток пути, в том числе с '/' (как и до таблицы маршрутов,
+// /api/v1/maps/a/b ищет карту "a/b")
+const Route* FindRoute(ApiRequest& request) {
+    if (const Route* route = LookupRoute(request.path)) {
+        return route;
+    }
+
+    const Route* found = nullptr;
+    for (const Route& route : ROUTES) {
+        if (route.with_param && request.path.starts_with(route.path)
+            && (!found || route.path.size() > found->path.size())) {
+            found = &route;
+        }
+    }
+
+    if (found) {
+        request.param = request.path.substr(found->path.size());
+    }
+    return found;
+}
+
+unsigned MethodToMask(http::verb method) {
+    switch (method) {
+        case http::verb::get:
+            return METHOD_GET;
+        case http::verb::head:
+            return METHOD_HEAD;
+        case http::verb::post:
+            return METHOD_POST;
+        default:
+            return 0;
+    }
+}
+
+StringResponse ErrorResponse(const ApiRequest& request, http::status status, std::string_view code, std::string_view message, bool cache = true) {
+    boost::json::object res;
+
+    res["code"] = code;
+    res["message"] = message;
+
+    std::string text = boost::json::serialize(res);
+
+    return MakeStringResponse(status, text, request.version, request.keep_alive, ContentType::APPLICATION_JSON, cache);
+}
+
+StringResponse JsonResponse(const ApiRequest& request, const boost::json::value& value) {
+    std::string body = boost::json::serialize(value);
+    return MakeStringResponse(http::status::ok, body, request.version, request.keep_alive, ContentType::APPLICATION_JSON, true);
+}
+
+// Проверка заголовка Authorization и поиск игрока по токену
+std::optional<StringResponse> Authorize(ApiRequest& request) {
+    constexpr std::string_view bearer_prefix = "Bearer ";
+
+    // нет нужного заголовка или он некорректный
+    if (!request.authorization ||
+        request.authorization->size() <= bearer_prefix.size() ||
+        !request.authorization->starts_with(bearer_prefix)) {
+        return ErrorResponse(request, http::status::unauthorized, "invalidToken", "Authorization header is missing");
+    }
+
+    std::string_view token = request.authorization->substr(bearer_prefix.size());
+
+    // некорректный токен
+    if (!isValidHex32(token)) {
+        return ErrorResponse(request, http::status::unauthorized, "invalidToken", "Authorization header is missing");
+    }
+
+    request.player = Players::FindPlayerByToken(std::string(token));
+
+    // пользователя не существует
+    if (!request.player) {
+        return ErrorResponse(request, http::status::unauthorized, "unknownToken", "Player token has not been found");
+    }
+
+    return std::nullopt;
+}
+
+std::shared_ptr<const model::MapResponses> BuildMapResponses(const model::MapCatalog& catalog) {
+    auto responses = std::make_shared<model::MapResponses>();
+
+    boost::json::array maps;
+    for (const auto& map : catalog.GetMaps()) {
+        maps.push_back(MapToJson(*map));
+        responses->map_by_id.emplace(*map->GetId(), MapFullToJson(*map));
+    }
+    responses->maps = boost::json::serialize(maps);
+
+    return responses;
+}
+
+// Ответы для набора карт. Обычно они построены заранее (PrepareMapResponses),
+// иначе строятся при первом запросе. Ответы хранятся в самом наборе, поэтому
+// запрос к прежнему набору во время перезагрузки не вытесняет ответы нового
+std::shared_ptr<const model::MapResponses> GetMapResponses(const model::MapCatalog& catalog) {
+    auto responses = catalog.GetResponses();
+    if (!responses) {
+        responses = BuildMapResponses(catalog);
+        catalog.SetResponses(responses);
+    }
+    return responses;
+}
+
+StringResponse HandleMaps(const ApiRequest& request, model::Game& game) {
+    const auto responses = GetMapResponses(*game.GetMapCatalog());
+
+    return MakeStringResponse(http::status::ok, responses->maps, request.version, request.keep_alive,
+                              ContentType::APPLICATION_JSON, true);
+}
+
+StringResponse HandleMap(const ApiRequest& request, model::Game& game) {
+    const auto responses = GetMapResponses(*game.GetMapCatalog());
+
+    auto it = responses->map_by_id.find(std::string(request.param));
+    if (it == responses->map_by_id.end()) {
+        return ErrorResponse(request, http::status::not_found, "mapNotFound", "Map not found");
+    }
+
+    return MakeStringResponse(http::status::ok, it->second, request.version, request.keep_alive,
+                              ContentType::APPLICATION_JSON, true);
+}
+
+// вход в игру
+StringResponse HandleJoin(const ApiRequest& request, model::Game& game) {
+    boost::json::value value;
+
+    try {
+        value = boost::json::parse(request.body);
+    } catch (const std::exception& e) {
+        // не парсится json
+        return ErrorResponse(request, http::status::bad_request, "invalidArgument", "Join game request parse error");
+    }
+
+    // не валидный
+    if (!value.is_object()) {
+        return ErrorResponse(request, http::status::bad_request, "invalidArgument", "Join game request parse error");
+    }
+
+    boost::json::object obj = value.as_object();
+
+    // нет нужных свойств
+    if (!obj.contains("userName") || !obj.contains("mapId")) {
+        return ErrorResponse(request, http::status::bad_request, "invalidArgument", "Join game request parse error");
+    }
+
+    // пустое имя
+    if (obj["userName"].as_string().empty()) {
+        return ErrorResponse(request, http::status::bad_request, "invalidArgument", "Invalid name");
+    }
+
+    auto user_name = std::string(obj["userName"].as_string());
+    auto map_id = std::string(obj["mapId"].as_string());
+
+    auto new_player = Players::AddPlayer(game, user_name, map_id);
+
+    // нет такой карты
+    if (!new_player) {
+        return ErrorResponse(request, http::status::not_found, "mapNotFound", "Map not found");
+    }
+
+    // формирование ответа
+    boost::json::object object_response;
+    object_response["authToken"] = *(new_player->GetToken());
+    object_response["playerId"] = new_player->Id();
+
+    return JsonResponse(request, object_response);
+}
+
+// список игроков в сессии с данным пользователем
+StringResponse HandlePlayers(const ApiRequest& request, [[maybe_unused]] model::Game& game) {
+    auto snapshot = request.player->GetSession()->GetSnapshot();
+    boost::json::object object_response;
+
+    int i = 0;
+    for (const auto& dog : snapshot->dogs) {
+        object_response[std::to_string(i)] = dog.name;
+        i++;
+    }
+
+    return JsonResponse(request, object_response);
+}
+
+// состояние сессии берется из последнего опубликованного снимка
+StringResponse HandleState(const ApiRequest& request, [[maybe_unused]] model::Game& game) {
+    auto snapshot = request.player->GetSession()->GetSnapshot();
+
+    boost::json::object object_response;
+    boost::json::object object_players;
+
+    for (const auto& dog : snapshot->dogs) {
+        boost::json::object object_player;
+
+        object_player["pos"] = boost::json::array{dog.cords.x, dog.cords.y};
+        object_player["speed"] = boost::json::array{dog.speed.x, dog.speed.y};
+
+        if (dog.direction == model::Direction::NORTH) {
+            object_player["dir"] = "U";
+        } else if (dog.direction == model::Direction::SOUTH) {
+            object_player["dir"] = "D";
+        } else if (dog.direction == model::Direction::EAST) {
+            object_player["dir"] = "R";
+        } else if (dog.direction == model::Direction::WEST) {
+            object_player["dir"] = "L";
+        }
+
+        boost::json::array bag;
+
+        for (const auto& loot_in_bag : dog.bag) {
+            boost::json::object loot_in_bag_object;
+            loot_in_bag_object["id"] = loot_in_bag.GetId();
+            loot_in_bag_object["type"] = loot_in_bag.GetType();
+
+            bag.push_back(loot_in_bag_object);
+        }
+
+        object_player["bag"] = bag;
+        object_player["score"] = dog.score;
+
+        object_players[std::to_string(dog.id)] = object_player;
+    }
+
+    object_response["players"] = object_players;
+
+    boost::json::object lost_objects;
+
+    for (const auto& loot : snapshot->loots) {
+        boost::json::object loot_object;
+
+        loot_object["type"] = loot.GetType();
+
+        auto pos = loot.GetPosition();
+        loot_object["pos"] = boost::json::array{pos.x, pos.y};
+
+        lost_objects[std::to_string(loot.GetId())] = loot_object;
+    }
+
+    object_response["lostObjects"] = lost_objects;
+
+    return JsonResponse(request, object_response);
+}
+
+StringResponse HandleAction(const ApiRequest& request, model::Game& game) {
+    boost::json::value value;
+
+    try {
+        value = boost::json::parse(request.body);
+    } catch (const std::exception& e) {
+        // не парсится json
+        return ErrorResponse(request, http::status::bad_request, "invalidArgument", "Failed to parse action");
+    }
+
+    // не валидный или нет нужных свойств
+    if (!value.is_object() || !value.as_object().contains("move") || !value.as_object().at("move").is_string()) {
+        return ErrorResponse(request, http::status::bad_request, "invalidArgument", "Failed to parse action");
+    }
+
+    std::string dir = std::string(value.as_object().at("move").as_string());
+
+    // некорректное направление
+    if (!dir.empty() && dir != "L" && dir != "R" && dir != "U" && dir != "D") {
+        return ErrorResponse(request, http::status::bad_request, "invalidArgument", "Failed to parse action");
+    }
+
+    // при работе по таймеру команда применяется в начале следующего тика,
+    // в тестовом режиме - сразу (запрос уже выполняется в strand игры)
+    if (game.IsInTestState()) {
+        const auto& session = request.player->GetSession();
+        if (model::Dog* dog = session->FindDog(request.player->GetDog())) {
+            dog->SetDirection(dir);
+        }
+        session->PublishSnapshot();
+        if (auto* events = game.GetEventSink()) {
+            events->Append(journal::MoveEvent{request.player->GetDogId(), std::move(dir)});
+        }
+    } else {
+        request.player->GetSession()->EnqueueAction({request.player->GetDog(), std::move(dir)});
+    }
+
+    return JsonResponse(request, boost::json::object{});
+}
+
+StringResponse HandleTick(const ApiRequest& request, model::Game& game) {
+    boost::json::value value;
+
+    try {
+        value = boost::json::parse(request.body);
+    } catch (const std::exception& e) {
+        return ErrorResponse(request, http::status::bad_request, "invalidArgument", "Failed to parse tick request JSON");
+    }
+
+    // не валидный или нет нужных свойств
+    if (!value.is_object() || !value.as_object().contains("timeDelta") ||
+        value.as_object().at("timeDelta").kind() != boost::json::kind::int64) {
+        return ErrorResponse(request, http::status::bad_request, "invalidArgument", "Failed to parse tick request JSON");
+    }
+
+    if (!game.IsInTestState()) {
+        return ErrorResponse(request, http::status::bad_request, "invalidArgument", "Invalid endpoint");
+    }
+
+    int tick = static_cast<int>(value.as_object().at("timeDelta").get_int64());
+
+    // логика запроса
+    try {
+        game.UpdateTickState(tick);
+    } catch (const std::exception& e) {
+        return ErrorResponse(request, http::status::bad_request, "invalidArgument", "Invalid endpoint");
+    }
+
+    return JsonResponse(request, boost::json::object{});
+}
+
+StringResponse HandleRecords(const ApiRequest& request, model::Game& game) {
+    // ищу нужные параметры
+    int start = 0;
+    int maxItems = 100;
+
+    // использую boost.url для парсинга строки
+    try {
+        urls::url_view url_view = urls::parse_uri_reference(request.target).value();
+
+        for (auto param : url_view.params()) {
+            if (param.key == "start") {
+                start = std::stoi(std::string(param.value));
+            } else if (param.key == "maxItems") {
+                maxItems = std::stoi(std::string(param.value));
+            }
+        }
+    } catch (const std::exception& e) {
+        return ErrorResponse(request, http::status::bad_request, "invalidArgument", "Failed to parse records request");
+    }
+
+    if (maxItems > 100) {
+        return ErrorResponse(request, http::status::bad_request, "badRequest", "Too many items requested", false);
+    }
+
+    auto records = game.GetRecordStore()->GetPlayersInfo(start, maxItems);
+    boost::json::array res;
+
+    for (const auto& record : records) {
+        boost::json::object record_obj;
+
+        record_obj[std::string("name")] = record.name;
+        record_obj[std::string("score")] = record.total_score;
+        record_obj[std::string("playTime")] =
+        static_cast<double>(record.full_game_period) / 1000;
+
+        res.push_back(record_obj);
+    }
+
+    return JsonResponse(request, res);
+}
+
+StringResponse DispatchRoute(const Route* route, ApiRequest& request, model::Game& game) {
+    if (!route) {
+        return ErrorResponse(request, http::status::bad_request, "badRequest", "Bad request", false);
+    }
+
+    // некорректный метод
+    if (!(route->methods & MethodToMask(request.method))) {
+        auto response = ErrorResponse(request, http::status::method_not_allowed, "invalidMethod", route->method_error);
+        response.set(http::field::allow, route->allow);
+        return response;
+    }
+
+    // нет нужного заголовка content_type
+    if (route->need_json && request.content_type != ContentType::APPLICATION_JSON) {
+        return ErrorResponse(request, http::status::bad_request, "invalidArgument", "Invalid content type");
+    }
+
+    if (route->need_auth) {
+        if (auto error = Authorize(request)) {
+            return std::move(*error);
+        }
+    }
+
+    switch (route->endpoint) {
+        case Endpoint::MAPS:
+            return HandleMaps(request, game);
+        case Endpoint::MAP:
+            return HandleMap(request, game);
+        case Endpoint::JOIN:
+            return HandleJoin(request, game);
+        case Endpoint::PLAYERS:
+            return HandlePlayers(request, game);
+        case Endpoint::STATE:
+            return HandleState(request, game);
+        case Endpoint::ACTION:
+            return HandleAction(request, game);
+        case Endpoint::TICK:
+            return HandleTick(request, game);
+        case Endpoint::RECORDS:
+            return HandleRecords(request, game);
+    }
+
+    return ErrorResponse(request, http::status::bad_request, "badRequest", "Bad request", false);
+}
+
+// Гистограмма задержки ответа для пары (маршрут, код ответа).
+// Ссылки на метрики кэшируются в потоке, чтобы не брать мьютекс реестра на каждый запрос
+metrics::Histogram& RequestLatency(const Route* route, unsigned status) {
+    thread_local std::unordered_map<std::uint64_t, metrics::Histogram*> cache;
+
+    const std::uint64_t route_index = route ? static_cast<std::uint64_t>(route - ROUTES.data()) : ROUTES.size();
+    const std::uint64_t key = (route_index << 16) | status;
+
+    auto& histogram = cache[key];
+    if (!histogram) {
+        histogram = &metrics::Registry::Instance().GetHistogram(
+            "api_request_duration_seconds",
+            "Time from receiving an API request to building the response",
+            metrics::Labels({{"route", route ? route->path : "unknown"sv}, {"status", std::to_string(status)}}));
+    }
+    return *histogram;
+}
+
+} // namespace
+
+void PrepareMapResponses(const model::MapCatalog& catalog) {
+    catalog.SetResponses(BuildMapResponses(catalog));
+}
+
+bool NeedsApiStrand(std::string_view target, const model::Game& game) {
+    ApiRequest request;
+    request.path = target.substr(0, target.find('?'));
+
+    const Route* route = FindRoute(request);
+    return !route || !route->off_strand || game.IsInTestState();
+}
+
+StringResponse HandleApiRequest(ApiRequest& request, model::Game& game) {
+    request.path = request.target.substr(0, request.target.find('?'));
+
+    const Route* route = FindRoute(request);
+    TRACE_SPAN(route ? route->path : "/api/unknown"sv);
+    StringResponse response = DispatchRoute(route, request, game);
+
+    RequestLatency(route, response.result_int()).Observe(std::chrono::high_resolution_clock::now() - request.start_time);
+
+    return response;
+}
+
+bool isValidHex32(std::string_view str) {
     return str.size() == 32 &&
            std::all_of(str.begin(), str.end(), [](unsigned char c) {
                return std::isxdigit(c);
@@ -67,7 +605,7 @@ boost::json::object OfficeToJson(const model::Office& office) {
     return new_office;
 }
 
-boost::json::object MapFullToJson(const model::Map& map) {
+std::string MapFullToJson(const model::Map& map) {
     boost::json::object res;
     
     res[KEY_ID] = *map.GetId();
@@ -76,7 +614,6 @@ boost::json::object MapFullToJson(const model::Map& map) {
     boost::json::array roads;
     boost::json::array buildings;
     boost::json::array offices;
-    boost::json::array loots;
     
     auto map_roads = map.GetRoads();
     auto map_buildings = map.GetBuildings();
@@ -94,16 +631,23 @@ boost::json::object MapFullToJson(const model::Map& map) {
         offices.push_back(OfficeToJson(office));
     }
     
-    for (const auto& loot : ExtraData::ReadAll(ExtraData::NameHelper({*map.GetId() , KEY_LOOT_TYPES}))) {
-        loots.push_back(boost::json::parse(loot));
-    }
-    
     res[KEY_ROADS] = roads;
     res[KEY_BUILDINGS] = buildings;
     res[KEY_OFFICES] = offices;
-    res[KEY_LOOT_TYPES] = loots;
     
-    return res;
+    // типы лута вставляются готовыми фрагментами из конфига, без разбора и повторной сериализации
+    std::string text = boost::json::serialize(res);
+    text.pop_back();
+    text += ",\"" + KEY_LOOT_TYPES + "\":[";
+    bool first = true;
+    for (const auto& type : map.GetLootTypes()) {
+        text += first ? "" : ",";
+        first = false;
+        text += type.json;
+    }
+    text += "]}";
+    
+    return text;
 }
 
 } // namespace api_handler
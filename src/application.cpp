@@ -1,6 +1,9 @@
 #include "application.h"
 
+#include "journal.h"
+
 std::vector<PlayerShared> Players::players_;
+std::shared_mutex Players::mutex_;
 uint64_t Player::counter_ = 0;
 
 std::string TokenGenerator::GetToken() {
@@ -29,23 +32,37 @@ std::mt19937_64 TokenGenerator::init_generator() {
 
 PlayerShared Players::AddPlayer(model::Game& game, std::string user_name, std::string map_id) {
     
-    auto new_dog = std::make_shared<Dog>(user_name);
-    auto session = game.AddDogToSession(new_dog, map_id);
+    auto new_dog = game.AddDogToSession(Dog(user_name), map_id);
     
     // нет такой карты
-    if (!session) {
+    if (!new_dog.session) {
         return nullptr;
     }
     
-    players_.push_back(PlayerShared(new Player(new_dog, session)));
-    return players_.back();
+    const Dog& dog = *new_dog.Get();
+    auto player = std::make_shared<Player>(new_dog.handle, dog.GetId(), new_dog.session);
+    
+    if (auto* events = game.GetEventSink()) {
+        const auto cords = dog.GetCords();
+        events->Append(journal::JoinEvent{player->Id(), dog.GetId(), *player->GetToken(),
+                                           user_name, map_id, cords.x, cords.y});
+    }
+    
+    AddPlayer(player);
+    return player;
+}
+
+void Players::AddPlayer(PlayerShared player) {
+    std::unique_lock lock{mutex_};
+    players_.push_back(std::move(player));
 }
 
 PlayerShared Players::FindPlayerByToken(const std::string& token) {
     
     Token player_token(token);
     
-    for (auto player : players_) {
+    std::shared_lock lock{mutex_};
+    for (const auto& player : players_) {
         if (player->GetToken() == player_token) {
             return player;
         }
@@ -54,24 +71,9 @@ PlayerShared Players::FindPlayerByToken(const std::string& token) {
     return nullptr;
 }
 
-Dogs& Player::GetSessionDogs() const noexcept {
-    return session_->GetDogs();
-}
-
-DogShared Players::FindDogByToken(const std::string& token) {
-    auto player = FindPlayerByToken(token);
-    return player->GetDog();
-}
-
 void Players::RemovePlayerByDogId(int id) {
-    for (auto it = players_.begin(); it != players_.end(); ) {
-        auto player = *it;
-        
-        if (player->GetDog()->GetId() == id) {
-            it = players_.erase(it);
-        } else {
-            ++it;
-        }
-        
-    }
+    std::unique_lock lock{mutex_};
+    std::erase_if(players_, [id](const PlayerShared& player) {
+        return player->GetDogId() == id;
+    });
 }
@@ -4,6 +4,8 @@
 #include <sstream>
 #include <iomanip>
 #include <string>
+#include <shared_mutex>
+#include <algorithm>
 
 #include "model.h"
 #include "tagged.h"
@@ -24,12 +26,13 @@ private:
 class Player {
 public:
     
-    Player(DogShared dog, GameSessionShared session) : dog_(dog), session_(session){
+    Player(DogHandle dog, int dog_id, GameSessionShared session) : dog_(dog), dog_id_(dog_id), session_(session){
         id_ = counter_++;
         token_ = Token(TokenGenerator::GetToken());
     }
     
-    Player(uint64_t id, std::string token, DogShared dog, GameSessionShared session) : id_(id), token_(Token(token)), dog_(dog), session_(session) {}
+    Player(uint64_t id, std::string token, DogHandle dog, int dog_id, GameSessionShared session)
+        : id_(id), token_(Token(token)), dog_(dog), dog_id_(dog_id), session_(session) {}
     
     Token& GetToken() noexcept {
         return token_;
@@ -39,45 +42,70 @@ public:
         return id_;
     }
     
-    Dogs& GetSessionDogs() const noexcept ;
-    
-    DogShared GetDog() const noexcept {
+    // Ручка собаки в пуле сессии игрока; саму собаку можно получить только в strand игры
+    DogHandle GetDog() const noexcept {
         return dog_;
     }
     
-    GameSessionShared GetSession() {
-        return session_;
+    int GetDogId() const noexcept {
+        return dog_id_;
     }
     
-    const GameSessionShared GetSession() const {
+    const GameSessionShared& GetSession() const noexcept {
         return session_;
     }
     
+    // Вызывается для восстановленных игроков, чтобы новые id с ними не совпадали
+    static void ReserveId(uint64_t id) noexcept {
+        counter_ = std::max(counter_, id + 1);
+    }
+    
+    // Id, который получит следующий игрок
+    static uint64_t NextId() noexcept {
+        return counter_;
+    }
+    
 private:
     uint64_t id_;
     Token token_{"default"};
-    DogShared dog_;
+    DogHandle dog_;
+    int dog_id_;
     GameSessionShared session_;
     
     static uint64_t counter_;
 };
 
+// Список игроков читается из потоков ввода-вывода (авторизация действий),
+// а изменяется в strand игры, поэтому доступ к нему защищен shared_mutex
 class Players {
 public:
     
     static PlayerShared AddPlayer(model::Game& game, std::string map_id, std::string user_name);
+    // Добавляет уже созданного игрока (при восстановлении из журнала)
+    static void AddPlayer(PlayerShared player);
     static PlayerShared FindPlayerByToken(const std::string& token);
-    static DogShared FindDogByToken(const std::string& token);
     static void RemovePlayerByDogId(int id);
     
-    static std::vector<PlayerShared> GetAllPlayers() {
-        return players_;
+    // Обходит игроков под блокировкой, не копируя список
+    template <typename Fn>
+    static void ForEach(Fn&& fn) {
+        std::shared_lock lock{mutex_};
+        for (const auto& player : players_) {
+            fn(player);
+        }
+    }
+    
+    static std::size_t Count() {
+        std::shared_lock lock{mutex_};
+        return players_.size();
     }
     
     static void SetAllPlayers(const std::vector<PlayerShared>& new_players) {
+        std::unique_lock lock{mutex_};
         players_ = new_players;
     }
     
 private:
     static std::vector<PlayerShared> players_;
+    static std::shared_mutex mutex_;
 };
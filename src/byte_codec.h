@@ -0,0 +1,292 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace codec {
+
+/*
+ *  Общие части двоичных форматов сервера. Числа хранятся в порядке байтов
+ *  платформы (little-endian, проверяется в форматах файлов).
+ *
+ *  Потоковые записи (журнал, запись сеанса, запись HTTP-трафика) - значения
+ *  фиксированного размера и строки с префиксом длины подряд: Put, PutString
+ *  и ByteReader.
+ *
+ *  Файлы с секциями (файл состояния, набор карт) - заголовок с сигнатурой,
+ *  версией, размером и контрольной суммой, таблица секций и секции из записей
+ *  фиксированного размера, выровненные по 8 байт: FileHeader, SectionEntry,
+ *  LayoutSection, WriteFileHeader, ReadFileHeader, ReadSectionTable и SectionReader.
+ */
+
+// Данные оборваны или повреждены
+class FormatError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// FNV-1a по 64-битным словам (хвост дополняется нулями). Обрабатывает
+// по 8 байт за шаг, поэтому не становится узким местом при записи больших файлов
+inline std::uint64_t Checksum(std::string_view data) noexcept {
+    constexpr std::uint64_t FNV_OFFSET = 14695981039346656037ull;
+    constexpr std::uint64_t FNV_PRIME = 1099511628211ull;
+
+    std::uint64_t hash = FNV_OFFSET;
+    std::size_t pos = 0;
+    for (; pos + sizeof(std::uint64_t) <= data.size(); pos += sizeof(std::uint64_t)) {
+        std::uint64_t word;
+        std::memcpy(&word, data.data() + pos, sizeof(word));
+        hash = (hash ^ word) * FNV_PRIME;
+    }
+    if (pos < data.size()) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, data.data() + pos, data.size() - pos);
+        hash = (hash ^ word) * FNV_PRIME;
+    }
+    return hash;
+}
+
+template <typename T>
+void Put(std::string& out, const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Строка с префиксом длины типа Size
+template <typename Size = std::uint32_t>
+void PutString(std::string& out, std::string_view str) {
+    Put(out, static_cast<Size>(str.size()));
+    out += str;
+}
+
+// Читает значения, записанные Put и PutString, по порядку. При выходе
+// за границы выбрасывает FormatError с текстом "<what> is truncated"
+class ByteReader {
+public:
+    ByteReader(std::string_view data, std::string_view what) : data_(data), what_(what) {}
+
+    template <typename T>
+    T Get() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        Require(sizeof(T));
+        T value;
+        std::memcpy(&value, data_.data(), sizeof(T));
+        data_.remove_prefix(sizeof(T));
+        return value;
+    }
+
+    template <typename Size = std::uint32_t>
+    std::string GetString() {
+        const auto size = Get<Size>();
+        Require(size);
+        std::string result(data_.substr(0, size));
+        data_.remove_prefix(size);
+        return result;
+    }
+
+    // Непрочитанный остаток
+    std::string_view& Rest() noexcept {
+        return data_;
+    }
+
+private:
+    void Require(std::uint64_t size) const {
+        if (data_.size() < size) {
+            throw FormatError(std::string(what_) + " is truncated");
+        }
+    }
+
+    std::string_view data_;
+    std::string_view what_;
+};
+
+inline constexpr std::size_t SECTION_ALIGNMENT = 8;
+
+using Magic = std::array<char, 8>;
+
+struct FileHeader {
+    Magic magic;
+    std::uint32_t version;
+    std::uint32_t section_count;
+    std::uint64_t file_size;
+    std::uint64_t checksum;  // контрольная сумма всех байтов после заголовка
+};
+
+struct SectionEntry {
+    std::uint32_t kind;
+    std::uint32_t record_size;
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::uint64_t count;
+};
+
+// Ссылка на строку в секции строк
+struct StringRef {
+    std::uint32_t offset;
+    std::uint32_t size;
+};
+
+constexpr std::size_t AlignUp(std::size_t value) noexcept {
+    return (value + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+// Смещение первой секции после заголовка и таблицы из section_count секций
+constexpr std::size_t FirstSectionOffset(std::size_t section_count) noexcept {
+    return AlignUp(sizeof(FileHeader) + sizeof(SectionEntry) * section_count);
+}
+
+[[noreturn]] inline void ThrowCorrupted(std::string_view format, std::string_view what) {
+    throw FormatError("Corrupted " + std::string(format) + ": " + std::string(what));
+}
+
+// Записывает значение по смещению в заранее выделенный буфер
+template <typename T>
+void PutAt(std::string& buffer, std::size_t offset, const T& value) noexcept {
+    static_assert(std::is_trivially_copyable_v<T>);
+    std::memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+inline void PutBytesAt(std::string& buffer, std::size_t offset, std::string_view bytes) noexcept {
+    if (!bytes.empty()) {
+        std::memcpy(buffer.data() + offset, bytes.data(), bytes.size());
+    }
+}
+
+// Размечает секцию kind с offset и возвращает выровненное смещение следующей
+template <typename Section, std::size_t N>
+std::size_t LayoutSection(std::array<SectionEntry, N>& sections, Section kind, std::size_t record_size,
+                          std::size_t count, std::size_t offset) noexcept {
+    auto& section = sections[static_cast<std::size_t>(kind)];
+    section.kind = static_cast<std::uint32_t>(kind);
+    section.record_size = static_cast<std::uint32_t>(record_size);
+    section.offset = offset;
+    section.size = record_size * count;
+    section.count = count;
+    return AlignUp(offset + section.size);
+}
+
+// Смещение записи index секции kind
+template <typename Section, std::size_t N>
+std::size_t RecordOffset(const std::array<SectionEntry, N>& sections, Section kind, std::size_t index) noexcept {
+    const auto& section = sections[static_cast<std::size_t>(kind)];
+    return section.offset + index * section.record_size;
+}
+
+// Записывает таблицу секций и заголовок с контрольной суммой. Вызывается
+// последним, когда все секции буфера уже заполнены
+template <std::size_t N>
+void WriteFileHeader(std::string& buffer, const Magic& magic, std::uint32_t version,
+                     const std::array<SectionEntry, N>& sections) {
+    for (std::size_t i = 0; i < N; ++i) {
+        PutAt(buffer, sizeof(FileHeader) + i * sizeof(SectionEntry), sections[i]);
+    }
+
+    FileHeader header{};
+    header.magic = magic;
+    header.version = version;
+    header.section_count = static_cast<std::uint32_t>(N);
+    header.file_size = buffer.size();
+    header.checksum = Checksum(std::string_view(buffer).substr(sizeof(FileHeader)));
+    PutAt(buffer, 0, header);
+}
+
+inline bool HasMagic(std::string_view data, const Magic& magic) noexcept {
+    return data.size() >= magic.size() && std::memcmp(data.data(), magic.data(), magic.size()) == 0;
+}
+
+// Проверяет сигнатуру и размер файла и возвращает заголовок.
+// Версию проверяет сам формат: правила совместимости у форматов разные
+inline FileHeader ReadFileHeader(std::string_view data, const Magic& magic, std::string_view format) {
+    if (data.size() < sizeof(FileHeader) || !HasMagic(data, magic)) {
+        ThrowCorrupted(format, "bad signature");
+    }
+
+    FileHeader header;
+    std::memcpy(&header, data.data(), sizeof(FileHeader));
+
+    if (header.file_size != data.size()) {
+        ThrowCorrupted(format, "size mismatch");
+    }
+    return header;
+}
+
+// Проверяет число секций и контрольную сумму и читает первые section_count секций
+// таблицы. Каждая секция должна иметь свой номер, размер записи из record_sizes
+// и лежать внутри файла. Секции, которых нет в файле старой версии, остаются пустыми
+template <std::size_t N>
+std::array<SectionEntry, N> ReadSectionTable(std::string_view data, const FileHeader& header, std::size_t section_count,
+                                             const std::array<std::size_t, N>& record_sizes, std::string_view format) {
+    if (section_count > N || header.section_count != section_count
+        || data.size() < sizeof(FileHeader) + sizeof(SectionEntry) * section_count) {
+        ThrowCorrupted(format, "bad section table");
+    }
+    if (header.checksum != Checksum(data.substr(sizeof(FileHeader)))) {
+        ThrowCorrupted(format, "checksum mismatch");
+    }
+
+    std::array<SectionEntry, N> sections{};
+    for (std::size_t i = 0; i < section_count; ++i) {
+        auto& section = sections[i];
+        std::memcpy(&section, data.data() + sizeof(FileHeader) + i * sizeof(SectionEntry), sizeof(SectionEntry));
+        if (section.kind != i || section.record_size != record_sizes[i] || section.count > data.size()
+            || section.size != section.count * section.record_size
+            || section.offset > data.size() || section.size > data.size() - section.offset) {
+            ThrowCorrupted(format, "bad section " + std::to_string(i));
+        }
+    }
+    return sections;
+}
+
+// Читает записи секций с проверкой границ. Строки лежат в секции Section::STRINGS
+template <typename Section, std::size_t N>
+class SectionReader {
+public:
+    SectionReader(std::string_view data, const std::array<SectionEntry, N>& sections, std::string_view format)
+        : data_(data), sections_(sections), format_(format) {
+    }
+
+    template <typename Record>
+    Record Get(Section kind, std::size_t index) const {
+        const auto& section = sections_[static_cast<std::size_t>(kind)];
+        if (index >= section.count) {
+            ThrowCorrupted(format_, "record index out of range");
+        }
+        Record record;
+        std::memcpy(&record, data_.data() + section.offset + index * sizeof(Record), sizeof(Record));
+        return record;
+    }
+
+    std::size_t Count(Section kind) const noexcept {
+        return sections_[static_cast<std::size_t>(kind)].count;
+    }
+
+    std::string_view GetString(StringRef ref) const {
+        const auto& section = sections_[static_cast<std::size_t>(Section::STRINGS)];
+        if (std::uint64_t(ref.offset) + ref.size > section.size) {
+            ThrowCorrupted(format_, "string out of range");
+        }
+        return data_.substr(section.offset + ref.offset, ref.size);
+    }
+
+    // Байты записей [begin, begin + count) секции kind
+    std::string_view GetRecords(Section kind, std::uint64_t begin, std::uint64_t count) const {
+        const auto& section = sections_[static_cast<std::size_t>(kind)];
+        if (begin > section.count || count > section.count - begin) {
+            ThrowCorrupted(format_, "range out of section");
+        }
+        return data_.substr(section.offset + begin * section.record_size, count * section.record_size);
+    }
+
+private:
+    std::string_view data_;
+    const std::array<SectionEntry, N>& sections_;
+    std::string_view format_;
+};
+
+}  // namespace codec
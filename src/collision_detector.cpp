@@ -1,6 +1,8 @@
 #include "collision_detector.h"
 #include <cassert>
 
+#include "trace.h"
+
 namespace collision_detector {
 
 CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D c) {
@@ -21,9 +23,11 @@ CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D
     return CollectionResult(sq_distance, proj_ratio);
 }
 
-std::vector<GatheringEvent> FindGatherEvents(
-    const ItemGathererProvider& provider) {
-    std::vector<GatheringEvent> detected_events;
+std::pmr::vector<GatheringEvent> FindGatherEvents(
+    const ItemGathererProvider& provider, std::pmr::memory_resource* resource) {
+    TRACE_SPAN("find_gather_events");
+
+    std::pmr::vector<GatheringEvent> detected_events(resource);
 
     static auto eq_pt = [](geom::Point2D p1, geom::Point2D p2) {
         return p1.x == p2.x && p1.y == p2.y;
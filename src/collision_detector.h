@@ -3,6 +3,7 @@
 #include "geom.h"
 
 #include <algorithm>
+#include <memory_resource>
 #include <vector>
 
 #include <type_traits>
@@ -51,6 +52,11 @@ public:
 
 class ItemGatherer : public collision_detector::ItemGathererProvider {
  public:
+  // resource - память списков (в тике - арена тика)
+  explicit ItemGatherer(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : items_(resource), gatherers_(resource) {
+  }
+
   //Methods
   size_t ItemsCount() const override {
     return items_.size();
@@ -76,9 +82,14 @@ class ItemGatherer : public collision_detector::ItemGathererProvider {
     gatherers_.push_back(gatherer);
   }
 
+  void Reserve(size_t items, size_t gatherers) {
+    items_.reserve(items);
+    gatherers_.reserve(gatherers);
+  }
+
  private:
-  std::vector<collision_detector::Item> items_;
-  std::vector<collision_detector::Gatherer> gatherers_;
+  std::pmr::vector<collision_detector::Item> items_;
+  std::pmr::vector<collision_detector::Gatherer> gatherers_;
 };
 
 struct GatheringEvent {
@@ -88,6 +99,9 @@ struct GatheringEvent {
     double time;
 };
 
-std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider);
+// resource - память результата
+std::pmr::vector<GatheringEvent> FindGatherEvents(
+    const ItemGathererProvider& provider,
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
 }  // namespace collision_detector
@@ -25,6 +25,7 @@ struct ContentType {
     constexpr static std::string_view TEXT_HTML = "text/html"sv;
     constexpr static std::string_view APPLICATION_JSON = "application/json"sv;
     constexpr static std::string_view TEXT_PLAIN = "text/plain"sv;
+    constexpr static std::string_view PROMETHEUS_TEXT = "text/plain; version=0.0.4"sv;
 };
 
 StringResponse MakeStringResponse(http::status status, std::string_view body, unsigned http_version,
@@ -0,0 +1,75 @@
+#include "config_reloader.h"
+
+#include <boost/asio/post.hpp>
+
+#include "api_handler.h"
+#include "json_loader.h"
+#include "log.h"
+#include "map_pack.h"
+#include "metrics.h"
+
+namespace {
+
+metrics::Counter& Reloads(std::string_view result) {
+    return metrics::Registry::Instance().GetCounter(
+        "config_reloads_total", "Map configuration reloads", metrics::Labels({{"result", result}}));
+}
+
+} // namespace
+
+ConfigReloader::ConfigReloader(model::Game& game, Strand strand, std::string config_file)
+    : game_(game)
+    , strand_(strand)
+    , config_file_(std::move(config_file)) {
+}
+
+bool ConfigReloader::Reload() {
+    if (busy_.exchange(true)) {
+        Reloads("skipped").Add();
+        return false;
+    }
+
+    // предыдущий поток уже завершил работу
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    worker_ = std::jthread([this] { Run(); });
+    return true;
+}
+
+void ConfigReloader::Run() {
+    static auto& duration = metrics::Registry::Instance().GetHistogram(
+        "config_reload_duration_seconds", "Time to load a new map configuration off the game strand");
+
+    try {
+        metrics::Stopwatch stopwatch;
+
+        model::Game loaded = map_pack::IsMapPackFile(config_file_)
+            ? map_pack::LoadMapPack(config_file_)
+            : json_loader::LoadGame(config_file_);
+
+        auto maps = loaded.GetMapCatalog();
+        api_handler::PrepareMapResponses(*maps);
+
+        stopwatch.Lap(duration);
+
+        net::post(strand_, [this, maps = std::move(maps), speed = loaded.GetSpeed(),
+                            capacity = loaded.GetBagCapacity(),
+                            max_session_dogs = loaded.GetMaxSessionDogs()]() mutable {
+            const auto count = maps->GetMaps().size();
+            game_.ReplaceMaps(std::move(maps), speed, capacity);
+            game_.SetMaxSessionDogs(max_session_dogs);
+            busy_ = false;
+
+            Reloads("ok").Add();
+            boost::json::value log_json = {{"config", config_file_}, {"maps", count}};
+            BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "config reloaded";
+        });
+    } catch (const std::exception& e) {
+        busy_ = false;
+
+        Reloads("error").Add();
+        boost::json::value log_json = {{"text", e.what()}, {"where", "reload_config"}};
+        BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "error";
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "sdk.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+
+#include "model.h"
+
+namespace net = boost::asio;
+
+/*
+ *  Перезагрузка конфигурации карт без перезапуска сервера (по SIGHUP).
+ *  Файл конфигурации (JSON или скомпилированный набор карт) читается в фоновом потоке,
+ *  там же собирается новый неизменяемый набор карт и строятся готовые ответы API о картах.
+ *  В strand игры остается только подмена набора. Сессии на картах прежнего
+ *  набора доигрывают, новые игроки попадают на карты нового.
+ */
+class ConfigReloader {
+public:
+    using Strand = net::strand<net::io_context::executor_type>;
+
+    ConfigReloader(model::Game& game, Strand strand, std::string config_file);
+
+    ConfigReloader(const ConfigReloader&) = delete;
+    ConfigReloader& operator=(const ConfigReloader&) = delete;
+
+    // Запускает перезагрузку. Возвращает false, если предыдущая еще не завершена
+    bool Reload();
+
+private:
+    void Run();
+
+    model::Game& game_;
+    Strand strand_;
+    std::string config_file_;
+
+    std::atomic<bool> busy_{false};
+    std::jthread worker_;
+};
@@ -7,6 +7,8 @@
 #include <mutex>
 #include <condition_variable>
 
+#include "metrics.h"
+
 class ConnectionPool;
 using PoolShared = std::shared_ptr<ConnectionPool>;
 
@@ -58,6 +60,10 @@ public:
     }
 
     ConnectionWrapper GetConnection() {
+        static auto& wait_time = metrics::Registry::Instance().GetHistogram(
+            "db_pool_wait_seconds", "Time spent waiting for a free database connection");
+        metrics::ScopedTimer timer{wait_time};
+        
         std::unique_lock lock{mutex_};
         // Блокируем текущий поток и ждём, пока cond_var_ не получит уведомление и не освободится
         // хотя бы одно соединение
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/*
+ *  Пул объектов с поколенческими ручками. Объекты лежат подряд в одном векторе
+ *  в порядке добавления и обходятся по ссылке, а снаружи на них ссылаются ручки:
+ *  номер ячейки и ее поколение. При удалении объекта поколение ячейки растет,
+ *  поэтому старые ручки перестают находить объект (Get возвращает nullptr),
+ *  даже если ячейку занял другой объект.
+ *  Ссылки и указатели на объекты действительны только до изменения пула.
+ */
+template <typename T>
+class EntityPool {
+public:
+    static constexpr std::uint32_t INVALID_SLOT = std::numeric_limits<std::uint32_t>::max();
+
+    struct Handle {
+        std::uint32_t slot = INVALID_SLOT;
+        std::uint32_t generation = 0;
+
+        bool operator==(const Handle&) const = default;
+    };
+
+    using iterator = typename std::vector<T>::iterator;
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    Handle Add(T value) {
+        std::uint32_t slot;
+        if (free_slots_.empty()) {
+            slot = static_cast<std::uint32_t>(slots_.size());
+            slots_.push_back(Slot{});
+        } else {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+        }
+
+        slots_[slot].index = static_cast<std::uint32_t>(items_.size());
+        items_.push_back(std::move(value));
+        item_slots_.push_back(slot);
+
+        return Handle{slot, slots_[slot].generation};
+    }
+
+    // Объект по ручке или nullptr, если он уже удален
+    T* Get(Handle handle) noexcept {
+        return IsAlive(handle) ? &items_[slots_[handle.slot].index] : nullptr;
+    }
+
+    const T* Get(Handle handle) const noexcept {
+        return IsAlive(handle) ? &items_[slots_[handle.slot].index] : nullptr;
+    }
+
+    // Ручка объекта с данным порядковым номером
+    Handle HandleAt(std::size_t index) const noexcept {
+        const std::uint32_t slot = item_slots_[index];
+        return Handle{slot, slots_[slot].generation};
+    }
+
+    // Удаляет объект, сохраняя порядок остальных; возвращает итератор на следующий
+    iterator Erase(iterator it) {
+        const auto index = static_cast<std::size_t>(it - items_.begin());
+        const std::uint32_t slot = item_slots_[index];
+
+        ++slots_[slot].generation;
+        free_slots_.push_back(slot);
+
+        item_slots_.erase(item_slots_.begin() + static_cast<std::ptrdiff_t>(index));
+        auto next = items_.erase(it);
+        for (std::size_t i = index; i < item_slots_.size(); ++i) {
+            slots_[item_slots_[i]].index = static_cast<std::uint32_t>(i);
+        }
+        return next;
+    }
+
+    // Удаляет объекты, для которых pred вернул true, сохраняя порядок остальных.
+    // pred вызывается по одному разу для каждого объекта по порядку. Оставшиеся
+    // объекты сдвигаются и переиндексируются за один проход, поэтому удаление
+    // k объектов из n стоит O(n), а не O(k * n), как k вызовов Erase
+    template <typename Pred>
+    std::size_t EraseIf(Pred pred) {
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < items_.size(); ++i) {
+            const std::uint32_t slot = item_slots_[i];
+            if (pred(items_[i])) {
+                ++slots_[slot].generation;
+                free_slots_.push_back(slot);
+                continue;
+            }
+            if (kept != i) {
+                items_[kept] = std::move(items_[i]);
+                item_slots_[kept] = slot;
+            }
+            slots_[slot].index = static_cast<std::uint32_t>(kept);
+            ++kept;
+        }
+
+        const std::size_t removed = items_.size() - kept;
+        items_.erase(items_.begin() + static_cast<std::ptrdiff_t>(kept), items_.end());
+        item_slots_.resize(kept);
+        return removed;
+    }
+
+    void Reserve(std::size_t size) {
+        items_.reserve(size);
+        item_slots_.reserve(size);
+        slots_.reserve(size);
+    }
+
+    std::size_t Size() const noexcept {
+        return items_.size();
+    }
+
+    bool Empty() const noexcept {
+        return items_.empty();
+    }
+
+    T& operator[](std::size_t index) noexcept {
+        return items_[index];
+    }
+
+    const T& operator[](std::size_t index) const noexcept {
+        return items_[index];
+    }
+
+    iterator begin() noexcept {
+        return items_.begin();
+    }
+
+    iterator end() noexcept {
+        return items_.end();
+    }
+
+    const_iterator begin() const noexcept {
+        return items_.begin();
+    }
+
+    const_iterator end() const noexcept {
+        return items_.end();
+    }
+
+private:
+    struct Slot {
+        std::uint32_t index = 0;        // номер объекта в items_, пока ячейка занята
+        std::uint32_t generation = 0;
+    };
+
+    bool IsAlive(Handle handle) const noexcept {
+        // у освобожденной ячейки поколение уже сдвинуто, так что совпадение значит, что она занята
+        return handle.slot < slots_.size() && slots_[handle.slot].generation == handle.generation;
+    }
+
+    std::vector<T> items_;
+    std::vector<std::uint32_t> item_slots_;     // ячейка каждого объекта
+    std::vector<Slot> slots_;
+    std::vector<std::uint32_t> free_slots_;
+};
+
+}  // namespace util
@@ -1,5 +1,7 @@
 #include "file_handler.h"
 
+#include <charconv>
+
 namespace file_handler {
 
 namespace fs = std::filesystem;
@@ -48,4 +50,70 @@ bool IsSubPath(fs::path path, fs::path base) {
     return true;
 }
 
+std::optional<ByteRange> ParseRange(std::string_view header, std::uint64_t size) {
+    constexpr std::string_view prefix = "bytes=";
+    
+    if (!header.starts_with(prefix)) {
+        return std::nullopt;
+    }
+    header.remove_prefix(prefix.size());
+    
+    // несколько диапазонов не поддерживаются
+    if (header.find(',') != std::string_view::npos) {
+        return std::nullopt;
+    }
+    
+    auto dash = header.find('-');
+    if (dash == std::string_view::npos) {
+        return std::nullopt;
+    }
+    
+    const auto parse_number = [](std::string_view str) -> std::optional<std::uint64_t> {
+        if (str.empty()) {
+            return std::nullopt;
+        }
+        std::uint64_t result = 0;
+        auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), result);
+        if (ec != std::errc{} || ptr != str.data() + str.size()) {
+            return std::nullopt;
+        }
+        return result;
+    };
+    
+    auto first_str = header.substr(0, dash);
+    auto last_str = header.substr(dash + 1);
+    
+    // bytes=-n: последние n байт файла
+    if (first_str.empty()) {
+        auto suffix = parse_number(last_str);
+        if (!suffix) {
+            return std::nullopt;
+        }
+        if (*suffix == 0 || size == 0) {
+            return ByteRange{0, 0, false};
+        }
+        return ByteRange{size - std::min(*suffix, size), size - 1};
+    }
+    
+    auto first = parse_number(first_str);
+    if (!first) {
+        return std::nullopt;
+    }
+    
+    std::uint64_t last = size == 0 ? 0 : size - 1;
+    if (!last_str.empty()) {
+        auto parsed_last = parse_number(last_str);
+        if (!parsed_last || *parsed_last < *first) {
+            return std::nullopt;
+        }
+        last = std::min(*parsed_last, last);
+    }
+    
+    if (*first >= size) {
+        return ByteRange{0, 0, false};
+    }
+    
+    return ByteRange{*first, last};
+}
+
 }
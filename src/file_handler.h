@@ -13,15 +13,29 @@
 #include <sstream>                       // Для std::ostringstream
 #include <utility>                       // Для std::move
 #include <filesystem>
+#include <optional>
+#include <cstdint>
 #include "common_handler.h"
 
 namespace file_handler {
 
 namespace fs = std::filesystem;
 
+// Диапазон байт [first, last] из заголовка Range
+struct ByteRange {
+    std::uint64_t first = 0;
+    std::uint64_t last = 0;
+    bool satisfiable = true;
+};
+
 std::string GetMimeType(const fs::path& path);
 bool IsSubPath(fs::path path, fs::path base);
 
+// Разбирает заголовок Range для файла размера size.
+// Поддерживается один диапазон вида bytes=a-b, bytes=a- и bytes=-n,
+// для остальных форм возвращается nullopt и файл отдается целиком
+std::optional<ByteRange> ParseRange(std::string_view header, std::uint64_t size);
+
 template <typename Request>
 VariantResponse ProcessFile(Request&& req, std::string& url, const fs::path& base_path_) {
     
@@ -77,7 +91,39 @@ VariantResponse ProcessFile(Request&& req, std::string& url, const fs::path& bas
         return error_response(http::status::not_found, "Not found", "File not found", ContentType::TEXT_PLAIN);
     }
     
-    return file_response(http::status::ok, std::move(file), GetMimeType(full_path));
+    const std::uint64_t file_size = file.size();
+    std::optional<ByteRange> range;
+    
+    if (auto it = req.find(http::field::range); it != req.end()) {
+        range = ParseRange(it->value(), file_size);
+    }
+    
+    // без Range (или с неподдерживаемым Range) отдаем файл целиком
+    if (!range) {
+        auto response = file_response(http::status::ok, std::move(file), GetMimeType(full_path));
+        response.set(http::field::accept_ranges, "bytes");
+        return response;
+    }
+    
+    if (!range->satisfiable) {
+        auto response = text_response(http::status::range_not_satisfiable, "", ContentType::TEXT_PLAIN);
+        response.set(http::field::content_range, "bytes */" + std::to_string(file_size));
+        return response;
+    }
+    
+    // тело начинается с текущей позиции файла, длина задается content_length
+    file.file().seek(range->first, ec);
+    
+    if (ec) {
+        return error_response(http::status::not_found, "Not found", "File not found", ContentType::TEXT_PLAIN);
+    }
+    
+    auto response = file_response(http::status::partial_content, std::move(file), GetMimeType(full_path));
+    response.content_length(range->last - range->first + 1);
+    response.set(http::field::accept_ranges, "bytes");
+    response.set(http::field::content_range, "bytes " + std::to_string(range->first) + "-"
+                 + std::to_string(range->last) + "/" + std::to_string(file_size));
+    return response;
 }
 
 } // namespace file_handler
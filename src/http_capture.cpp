@@ -0,0 +1,225 @@
+#include "http_capture.h"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "byte_codec.h"
+#include "log.h"
+#include "metrics.h"
+
+namespace http_capture {
+
+namespace {
+
+constexpr codec::Magic MAGIC = {'G', 'S', 'H', 'T', 'T', 'P', 'C', 'P'};
+
+// Вид записи после заголовка
+enum class Entry : std::uint8_t {
+    REQUEST = 1,
+    TOKEN
+};
+
+// вид записи и размер тела
+constexpr std::size_t ENTRY_HEADER_SIZE = sizeof(Entry) + sizeof(std::uint32_t);
+
+using codec::Put;
+using codec::PutString;
+
+// Дописывает запись: тело формирует fill
+template <typename Fill>
+void PutEntry(std::string& out, Entry entry, Fill&& fill) {
+    Put(out, entry);
+    const auto size_offset = out.size();
+    Put(out, std::uint32_t{0});
+    fill(out);
+    const auto size = static_cast<std::uint32_t>(out.size() - size_offset - sizeof(std::uint32_t));
+    std::memcpy(out.data() + size_offset, &size, sizeof(size));
+}
+
+// Читает тело записи, выбрасывает codec::FormatError при выходе за границы
+codec::ByteReader MakeReader(std::string_view payload) {
+    return codec::ByteReader(payload, "HTTP capture record");
+}
+
+Request DecodeRequest(std::string_view payload) {
+    auto reader = MakeReader(payload);
+    Request request;
+    request.time = std::chrono::microseconds(reader.Get<std::uint64_t>());
+    request.connection = reader.GetString();
+    request.method = reader.GetString();
+    request.target = reader.GetString();
+    const auto header_count = reader.Get<std::uint16_t>();
+    request.headers.reserve(header_count);
+    for (std::uint16_t i = 0; i < header_count; ++i) {
+        auto name = reader.GetString();
+        request.headers.emplace_back(std::move(name), reader.GetString());
+    }
+    request.body = reader.GetString();
+    return request;
+}
+
+} // namespace
+
+Writer::Writer(const std::string& path, std::chrono::milliseconds flush_interval)
+    : flush_interval_(flush_interval)
+    , start_(std::chrono::steady_clock::now())
+    , out_(path, std::ios::binary | std::ios::trunc) {
+    if (!out_) {
+        throw std::runtime_error("Cannot open HTTP capture file " + path);
+    }
+
+    std::string header;
+    header.append(MAGIC.data(), MAGIC.size());
+    Put(header, CAPTURE_VERSION);
+    out_.write(header.data(), static_cast<std::streamsize>(header.size()));
+    out_.flush();
+
+    writer_ = std::jthread([this](std::stop_token stop) { Run(stop); });
+}
+
+Writer::~Writer() {
+    writer_.request_stop();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    try {
+        Flush();
+    } catch (const std::exception& e) {
+        boost::json::value log_json = {{"text", e.what()}, {"where", "http_capture_shutdown"}};
+        BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "error";
+    }
+}
+
+std::uint64_t Writer::AppendRequest(std::string_view connection, std::string_view method, std::string_view target,
+                                    std::vector<std::pair<std::string, std::string>> headers, std::string_view body) {
+    static auto& captured = metrics::Registry::Instance().GetCounter(
+        "http_capture_requests_total", "HTTP requests written to the capture file");
+
+    const auto time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_);
+
+    std::lock_guard lock{mutex_};
+    PutEntry(pending_, Entry::REQUEST, [&](std::string& out) {
+        Put(out, static_cast<std::uint64_t>(time.count()));
+        PutString(out, connection);
+        PutString(out, method);
+        PutString(out, target);
+        Put(out, static_cast<std::uint16_t>(headers.size()));
+        for (const auto& [name, value] : headers) {
+            PutString(out, name);
+            PutString(out, value);
+        }
+        PutString(out, body);
+    });
+    captured.Add();
+    return next_request_++;
+}
+
+void Writer::AppendToken(std::uint64_t request, std::string_view token) {
+    std::lock_guard lock{mutex_};
+    PutEntry(pending_, Entry::TOKEN, [&](std::string& out) {
+        Put(out, request);
+        PutString(out, token);
+    });
+}
+
+void Writer::Flush() {
+    static auto& bytes_written = metrics::Registry::Instance().GetCounter(
+        "http_capture_bytes_written_total", "Bytes written to the HTTP capture file");
+
+    // io_mutex_ берется до извлечения буфера, чтобы записи шли в порядке добавления
+    std::lock_guard io_lock{io_mutex_};
+
+    std::string data;
+    {
+        std::lock_guard lock{mutex_};
+        data.swap(pending_);
+    }
+    if (data.empty()) {
+        return;
+    }
+
+    out_.write(data.data(), static_cast<std::streamsize>(data.size()));
+    out_.flush();
+    if (!out_) {
+        throw std::runtime_error("Cannot write HTTP capture file");
+    }
+    bytes_written.Add(data.size());
+}
+
+void Writer::Run(std::stop_token stop) {
+    while (!stop.stop_requested()) {
+        {
+            std::unique_lock lock{mutex_};
+            cond_var_.wait_for(lock, stop, flush_interval_, [] { return false; });
+        }
+        try {
+            Flush();
+        } catch (const std::exception& e) {
+            // после ошибки поток остается в состоянии сбоя, поэтому в лог попадает только первая
+            if (!std::exchange(failed_, true)) {
+                boost::json::value log_json = {{"text", e.what()}, {"where", "http_capture_write"}};
+                BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "error";
+            }
+        }
+    }
+}
+
+Capture ReadCapture(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Cannot open HTTP capture " + path);
+    }
+    std::string data(static_cast<std::size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    if (!file.read(data.data(), static_cast<std::streamsize>(data.size()))) {
+        throw std::runtime_error("Cannot read HTTP capture " + path);
+    }
+
+    std::string_view rest = data;
+    if (rest.size() < MAGIC.size() + sizeof(std::uint32_t)
+        || rest.substr(0, MAGIC.size()) != std::string_view(MAGIC.data(), MAGIC.size())) {
+        throw std::runtime_error(path + " is not an HTTP capture");
+    }
+    rest.remove_prefix(MAGIC.size());
+
+    std::uint32_t version;
+    std::memcpy(&version, rest.data(), sizeof(version));
+    if (version != CAPTURE_VERSION) {
+        throw std::runtime_error("Unsupported HTTP capture version " + std::to_string(version));
+    }
+    rest.remove_prefix(sizeof(version));
+
+    // хвост, недописанный из-за сбоя, отбрасывается
+    Capture capture;
+    while (rest.size() >= ENTRY_HEADER_SIZE) {
+        const auto entry = static_cast<Entry>(rest.front());
+        std::uint32_t size;
+        std::memcpy(&size, rest.data() + sizeof(Entry), sizeof(size));
+        if (rest.size() - ENTRY_HEADER_SIZE < size) {
+            break;
+        }
+        const auto payload = rest.substr(ENTRY_HEADER_SIZE, size);
+
+        try {
+            if (entry == Entry::REQUEST) {
+                capture.requests.push_back(DecodeRequest(payload));
+            } else if (entry == Entry::TOKEN) {
+                auto reader = MakeReader(payload);
+                const auto request = reader.Get<std::uint64_t>();
+                capture.tokens.push_back({request, reader.GetString()});
+            } else {
+                break;
+            }
+        } catch (const codec::FormatError&) {
+            break;
+        }
+        rest.remove_prefix(ENTRY_HEADER_SIZE + size);
+    }
+
+    return capture;
+}
+
+}  // namespace http_capture
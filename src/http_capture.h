@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace http_capture {
+
+/*
+ *  Запись входящих HTTP-запросов (--capture-http) для воспроизведения
+ *  инструментом game_replay (tools/game_replay.cpp).
+ *
+ *  После заголовка (сигнатура и версия) идут записи: вид, размер тела и тело.
+ *  Запрос хранит время прихода от начала записи, соединение клиента, метод,
+ *  цель, заголовки и тело. Для входа в игру дополнительно пишется выданный
+ *  токен: при воспроизведении сервер выдаст другие токены, и старые в
+ *  заголовках Authorization заменяются новыми.
+ */
+inline constexpr std::uint32_t CAPTURE_VERSION = 1;
+
+struct Request {
+    std::chrono::microseconds time{0};  // от начала записи
+    std::string connection;             // адрес и порт клиента
+    std::string method;
+    std::string target;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+};
+
+// Токен, выданный в ответ на запрос входа в игру
+struct IssuedToken {
+    std::uint64_t request;  // номер запроса в записи
+    std::string token;
+};
+
+struct Capture {
+    std::vector<Request> requests;
+    std::vector<IssuedToken> tokens;
+};
+
+class Writer {
+public:
+    // Создает файл и записывает заголовок
+    explicit Writer(const std::string& path,
+                    std::chrono::milliseconds flush_interval = std::chrono::milliseconds{100});
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    // Дописывает накопленные записи и останавливает поток записи
+    ~Writer();
+
+    // Добавляет запрос в буфер и возвращает его номер. Время прихода отсчитывается
+    // здесь, поэтому вызывается сразу после чтения запроса (из потоков ввода-вывода)
+    std::uint64_t AppendRequest(std::string_view connection, std::string_view method, std::string_view target,
+                                std::vector<std::pair<std::string, std::string>> headers, std::string_view body);
+
+    // Добавляет токен, выданный в ответ на запрос с номером request
+    void AppendToken(std::uint64_t request, std::string_view token);
+
+    // Записывает буфер в файл, при ошибке записи выбрасывает std::runtime_error
+    void Flush();
+
+private:
+    void Run(std::stop_token stop);
+
+    std::chrono::milliseconds flush_interval_;
+    std::chrono::steady_clock::time_point start_;
+
+    std::mutex mutex_;
+    std::condition_variable_any cond_var_;
+    std::string pending_;
+    std::uint64_t next_request_ = 0;
+
+    std::mutex io_mutex_;
+    std::ofstream out_;
+    bool failed_ = false;   // только в потоке записи
+
+    std::jthread writer_;
+};
+
+// Читает запись. Выбрасывает std::runtime_error, если заголовок поврежден;
+// записи читаются до первой неполной
+Capture ReadCapture(const std::string& path);
+
+}  // namespace http_capture
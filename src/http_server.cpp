@@ -1,7 +1,15 @@
 #include "http_server.h"
 
 #include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
 #include <iostream>
+#include <algorithm>
+#include <charconv>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <cerrno>
+#endif
 
 namespace http_server {
 
@@ -35,6 +43,151 @@ void SessionBase::OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std
     Read();
 }
 
+void SessionBase::Write(http::response<http::file_body>&& response) {
+    auto transfer = std::make_shared<FileTransfer>(std::move(response), stream_.get_executor());
+    
+    sys::error_code ec;
+    transfer->offset = transfer->response.body().file().pos(ec);
+    
+    if (ec) {
+        return OnWrite(true, ec, 0);
+    }
+    
+    // длина тела берется из Content-Length, он может быть меньше размера файла
+    transfer->remaining = transfer->response.body().size() - transfer->offset;
+    const auto content_length = transfer->response[http::field::content_length];
+    std::from_chars(content_length.data(), content_length.data() + content_length.size(), transfer->remaining);
+    
+    stream_.expires_after(FILE_WRITE_TIMEOUT);
+    http::async_write_header(stream_, transfer->serializer,
+                             beast::bind_front_handler(&SessionBase::OnWriteFileHeader, GetSharedThis(), transfer));
+}
+
+void SessionBase::OnWriteFileHeader(FileTransferShared transfer, beast::error_code ec, std::size_t bytes_written) {
+    if (ec) {
+        return OnWrite(true, ec, bytes_written);
+    }
+    
+    transfer->bytes_written = bytes_written;
+#ifdef __linux__
+    transfer->last_progress = net::steady_timer::clock_type::now();
+    WaitFileDeadline(transfer);
+#endif
+    WriteFileBody(std::move(transfer));
+}
+
+void SessionBase::WaitFileDeadline(FileTransferShared transfer) {
+    transfer->deadline.expires_at(transfer->last_progress + FILE_WRITE_TIMEOUT);
+    transfer->deadline.async_wait([self = GetSharedThis(), transfer](beast::error_code ec) {
+        if (ec) {
+            // передача закончилась и отменила таймер
+            return;
+        }
+        if (transfer->last_progress + FILE_WRITE_TIMEOUT > net::steady_timer::clock_type::now()) {
+            // после постановки таймера клиент принял еще порцию
+            return self->WaitFileDeadline(transfer);
+        }
+        // клиент перестал читать: закрытие сокета прерывает ожидание записи
+        sys::error_code ignored;
+        self->stream_.socket().close(ignored);
+    });
+}
+
+void SessionBase::FinishFileBody(const FileTransferShared& transfer, bool close, beast::error_code ec) {
+    transfer->deadline.cancel();
+    OnWrite(close, ec, transfer->bytes_written);
+}
+
+void SessionBase::WriteFileBody(FileTransferShared transfer) {
+    // За один вызов отправляем не больше этого объема, а следующую порцию ставим
+    // в очередь исполнителя, чтобы большой файл не занимал поток надолго
+    constexpr std::uint64_t MAX_CHUNK = 1 << 20;
+    
+    auto& socket = stream_.socket();
+    
+#ifdef __linux__
+    sys::error_code ec;
+    socket.native_non_blocking(true, ec);
+    
+    if (ec) {
+        return FinishFileBody(transfer, true, ec);
+    }
+    
+    while (transfer->remaining > 0) {
+        off_t offset = static_cast<off_t>(transfer->offset);
+        const auto count = static_cast<std::size_t>(std::min(transfer->remaining, MAX_CHUNK));
+        const ssize_t sent = ::sendfile(socket.native_handle(),
+                                        transfer->response.body().file().native_handle(),
+                                        &offset, count);
+        
+        if (sent > 0) {
+            transfer->offset += static_cast<std::uint64_t>(sent);
+            transfer->remaining -= static_cast<std::uint64_t>(sent);
+            transfer->bytes_written += static_cast<std::size_t>(sent);
+            transfer->last_progress = net::steady_timer::clock_type::now();
+            if (transfer->remaining == 0) {
+                break;
+            }
+            net::post(stream_.get_executor(), [self = GetSharedThis(), transfer] {
+                self->WriteFileBody(transfer);
+            });
+            return;
+        }
+        
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        
+        // буфер сокета заполнен - ждем, когда в него снова можно будет писать
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            socket.async_wait(tcp::socket::wait_write, [self = GetSharedThis(), transfer](beast::error_code ec) {
+                if (ec) {
+                    return self->FinishFileBody(transfer, true, ec);
+                }
+                self->WriteFileBody(transfer);
+            });
+            return;
+        }
+        
+        // файл оказался короче заявленного размера либо ошибка записи
+        ec = sent < 0 ? sys::error_code(errno, sys::system_category())
+                      : sys::error_code(EIO, sys::system_category());
+        return FinishFileBody(transfer, true, ec);
+    }
+    
+    FinishFileBody(transfer, transfer->response.need_eof(), {});
+#else
+    // без sendfile читаем файл кусками и пишем их в сокет
+    if (transfer->remaining == 0) {
+        return FinishFileBody(transfer, transfer->response.need_eof(), {});
+    }
+    
+    auto chunk = std::make_shared<std::vector<char>>(std::min(transfer->remaining, MAX_CHUNK));
+    
+    sys::error_code ec;
+    auto& file = transfer->response.body().file();
+    file.seek(transfer->offset, ec);
+    std::size_t read = ec ? 0 : file.read(chunk->data(), chunk->size(), ec);
+    
+    if (ec || read == 0) {
+        return FinishFileBody(transfer, true, ec ? ec : sys::error_code(EIO, sys::system_category()));
+    }
+    
+    // запись идет через tcp_stream, поэтому срок отслеживает он
+    stream_.expires_after(FILE_WRITE_TIMEOUT);
+    net::async_write(stream_, net::buffer(chunk->data(), read),
+                     [self = GetSharedThis(), transfer, chunk](beast::error_code ec, std::size_t written) {
+        if (ec) {
+            return self->FinishFileBody(transfer, true, ec);
+        }
+        transfer->offset += written;
+        transfer->remaining -= written;
+        transfer->bytes_written += written;
+        self->WriteFileBody(transfer);
+    });
+#endif
+}
+
 void SessionBase::Read() {
     using namespace std::literals;
     // Очищаем запрос от прежнего значения (метод Read может быть вызван несколько раз)
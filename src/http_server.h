@@ -5,11 +5,14 @@
 
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/strand.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/system/error_code.hpp>
 #include <boost/beast/http.hpp>
 
 #include <iostream>
+#include <cstdint>
 
 #include "log.h"
 
@@ -19,6 +22,7 @@ namespace net = boost::asio;
 using tcp = net::ip::tcp;
 namespace beast = boost::beast;
 namespace http = beast::http;
+namespace sys = boost::system;
 using namespace std::literals;
 
 class SessionBase {
@@ -46,10 +50,49 @@ protected:
         });
     }
     
+    // Файловые ответы пишутся отдельно: заголовок через Beast, а тело
+    // отправляется из файла напрямую в сокет (sendfile на Linux), без копирования
+    // в пользовательский буфер. Тело начинается с текущей позиции файла
+    // и имеет длину content_length, что позволяет отдавать диапазоны (Range)
+    void Write(http::response<http::file_body>&& response);
+    
     ~SessionBase() = default;
     
+    // Ответ может быть готов в другом потоке (например, в потоке игры),
+    // поэтому запись в сокет переносится в strand сессии
+    beast::tcp_stream::executor_type GetExecutor() {
+        return stream_.get_executor();
+    }
+    
 private:
     
+    // сколько ждать, пока клиент примет очередную порцию файла
+    static constexpr auto FILE_WRITE_TIMEOUT = 30s;
+    
+    struct FileTransfer {
+        FileTransfer(http::response<http::file_body>&& res, const beast::tcp_stream::executor_type& executor)
+            : response(std::move(res))
+            , serializer(response)
+            , deadline(executor) {
+        }
+        
+        http::response<http::file_body> response;
+        http::response_serializer<http::file_body> serializer;
+        std::uint64_t offset = 0;
+        std::uint64_t remaining = 0;
+        std::uint64_t bytes_written = 0;
+        // Тело пишется мимо таймаутов tcp_stream, поэтому у передачи свой таймер.
+        // Срок отсчитывается от последней отправленной порции
+        net::steady_timer deadline;
+        net::steady_timer::time_point last_progress;
+    };
+    using FileTransferShared = std::shared_ptr<FileTransfer>;
+    
+    void OnWriteFileHeader(FileTransferShared transfer, beast::error_code ec, std::size_t bytes_written);
+    void WriteFileBody(FileTransferShared transfer);
+    void WaitFileDeadline(FileTransferShared transfer);
+    void FinishFileBody(const FileTransferShared& transfer, bool close, beast::error_code ec);
+    
     void OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written);
     void Read();
     void OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read);
@@ -81,7 +124,9 @@ private:
         // чтобы продлить время жизни сессии до вызова лямбды.
         // Используется generic-лямбда функция, способная принять response произвольного типа
         request_handler_(std::move(request), remote_endpoint, [self = this->shared_from_this()](auto&& response) {
-            self->Write(std::move(response));
+            net::dispatch(self->GetExecutor(), [self, response = std::move(response)]() mutable {
+                self->Write(std::move(response));
+            });
         });
     }
     
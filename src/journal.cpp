@@ -0,0 +1,384 @@
+#include "journal.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "byte_codec.h"
+#include "log.h"
+#include "metrics.h"
+
+namespace journal {
+
+namespace {
+
+enum class EventType : std::uint8_t {
+    JOIN = 1,
+    MOVE,
+    TICK,
+    RETIRE
+};
+
+// размер тела и его контрольная сумма
+constexpr std::size_t RECORD_HEADER_SIZE = sizeof(std::uint32_t) + sizeof(std::uint64_t);
+
+using codec::Put;
+using codec::PutString;
+
+Event DecodeEvent(std::string_view payload) {
+    codec::ByteReader reader(payload, "Journal record");
+    switch (reader.Get<EventType>()) {
+        case EventType::JOIN: {
+            JoinEvent e;
+            e.player_id = reader.Get<std::uint64_t>();
+            e.dog_id = reader.Get<std::int32_t>();
+            e.token = reader.GetString();
+            e.name = reader.GetString();
+            e.map_id = reader.GetString();
+            e.x = reader.Get<double>();
+            e.y = reader.Get<double>();
+            return e;
+        }
+        case EventType::MOVE: {
+            MoveEvent e;
+            e.dog_id = reader.Get<std::int32_t>();
+            e.direction = reader.GetString();
+            return e;
+        }
+        case EventType::TICK: {
+            TickEvent e;
+            e.delta = reader.Get<std::int32_t>();
+            e.seed = reader.Get<std::uint64_t>();
+            return e;
+        }
+        case EventType::RETIRE:
+            return RetireEvent{reader.Get<std::int32_t>()};
+    }
+    throw codec::FormatError("Unknown journal event type");
+}
+
+std::string SegmentPath(const std::string& path, std::uint64_t segment) {
+    return path + "." + std::to_string(segment);
+}
+
+// Номера существующих сегментов журнала path по возрастанию
+std::vector<std::uint64_t> ListSegments(const std::string& path) {
+    namespace fs = std::filesystem;
+
+    const fs::path prefix(path);
+    fs::path directory = prefix.parent_path();
+    if (directory.empty()) {
+        directory = ".";
+    }
+    const std::string stem = prefix.filename().string() + ".";
+
+    std::vector<std::uint64_t> segments;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(directory, ec)) {
+        const std::string name = entry.path().filename().string();
+        if (!name.starts_with(stem) || name.size() == stem.size()) {
+            continue;
+        }
+        std::uint64_t segment = 0;
+        const char* begin = name.data() + stem.size();
+        const char* end = name.data() + name.size();
+        if (auto [ptr, err] = std::from_chars(begin, end, segment); err == std::errc{} && ptr == end) {
+            segments.push_back(segment);
+        }
+    }
+
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+} // namespace
+
+void EncodeRecord(std::string& out, const Event& event) {
+    const std::size_t start = out.size();
+    out.append(RECORD_HEADER_SIZE, '\0');
+
+    std::visit([&out](const auto& e) {
+        using T = std::decay_t<decltype(e)>;
+        if constexpr (std::is_same_v<T, JoinEvent>) {
+            Put(out, EventType::JOIN);
+            Put(out, e.player_id);
+            Put(out, static_cast<std::int32_t>(e.dog_id));
+            PutString(out, e.token);
+            PutString(out, e.name);
+            PutString(out, e.map_id);
+            Put(out, e.x);
+            Put(out, e.y);
+        } else if constexpr (std::is_same_v<T, MoveEvent>) {
+            Put(out, EventType::MOVE);
+            Put(out, static_cast<std::int32_t>(e.dog_id));
+            PutString(out, e.direction);
+        } else if constexpr (std::is_same_v<T, TickEvent>) {
+            Put(out, EventType::TICK);
+            Put(out, static_cast<std::int32_t>(e.delta));
+            Put(out, e.seed);
+        } else {
+            Put(out, EventType::RETIRE);
+            Put(out, static_cast<std::int32_t>(e.dog_id));
+        }
+    }, event);
+
+    const std::string_view payload = std::string_view(out).substr(start + RECORD_HEADER_SIZE);
+    const auto size = static_cast<std::uint32_t>(payload.size());
+    const std::uint64_t checksum = codec::Checksum(payload);
+    std::memcpy(out.data() + start, &size, sizeof(size));
+    std::memcpy(out.data() + start + sizeof(size), &checksum, sizeof(checksum));
+}
+
+std::optional<Event> DecodeRecord(std::string_view& data) {
+    if (data.size() < RECORD_HEADER_SIZE) {
+        return std::nullopt;
+    }
+
+    std::uint32_t size;
+    std::uint64_t checksum;
+    std::memcpy(&size, data.data(), sizeof(size));
+    std::memcpy(&checksum, data.data() + sizeof(size), sizeof(checksum));
+
+    const std::string_view rest = data.substr(RECORD_HEADER_SIZE);
+    if (rest.size() < size || codec::Checksum(rest.substr(0, size)) != checksum) {
+        return std::nullopt;
+    }
+
+    try {
+        Event event = DecodeEvent(rest.substr(0, size));
+        data = rest.substr(size);
+        return event;
+    } catch (const codec::FormatError&) {
+        return std::nullopt;
+    }
+}
+
+Journal::Journal(Settings settings, std::uint64_t segment)
+    : settings_(std::move(settings))
+    , segment_(segment)
+    , writer_([this](std::stop_token stop) { Run(stop); }) {
+}
+
+Journal::~Journal() {
+    writer_.request_stop();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    try {
+        Flush();
+    } catch (const std::exception& e) {
+        // при остановке повторять уже некому: события после контрольной точки теряются
+        boost::json::value log_json = {{"text", e.what()}, {"where", "journal_shutdown"}};
+        BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "error";
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void Journal::Append(const Event& event) {
+    static auto& events = metrics::Registry::Instance().GetCounter(
+        "journal_events_total", "Events appended to the journal");
+
+    std::lock_guard lock{mutex_};
+    if (pending_.empty() || pending_.back().segment != segment_) {
+        pending_.push_back({segment_, {}});
+    }
+    EncodeRecord(pending_.back().data, event);
+    events.Add();
+}
+
+std::uint64_t Journal::Rotate() {
+    std::lock_guard lock{mutex_};
+    return ++segment_;
+}
+
+void Journal::RemoveSegmentsBefore(std::uint64_t segment) {
+    for (auto old_segment : ListSegments(settings_.path)) {
+        if (old_segment >= segment) {
+            break;
+        }
+        std::error_code ec;
+        std::filesystem::remove(SegmentPath(settings_.path, old_segment), ec);
+    }
+}
+
+void Journal::Flush() {
+    // io_mutex_ берется до извлечения буфера, чтобы группы записывались в порядке добавления
+    std::lock_guard io_lock{io_mutex_};
+
+    std::vector<Chunk> chunks;
+    {
+        std::lock_guard lock{mutex_};
+        chunks.swap(pending_);
+    }
+
+    const std::size_t written = WriteChunks(chunks);
+    if (written == chunks.size()) {
+        return;
+    }
+
+    // Недописанные группы возвращаются в начало очереди, чтобы следующий сброс
+    // повторил их раньше событий, добавленных за это время
+    {
+        std::lock_guard lock{mutex_};
+        pending_.insert(pending_.begin(), std::make_move_iterator(chunks.begin() + static_cast<std::ptrdiff_t>(written)),
+                        std::make_move_iterator(chunks.end()));
+    }
+    throw std::runtime_error(write_error_);
+}
+
+void Journal::Run(std::stop_token stop) {
+    while (!stop.stop_requested()) {
+        {
+            std::unique_lock lock{mutex_};
+            cond_var_.wait_for(lock, stop, settings_.flush_interval, [] { return false; });
+        }
+        try {
+            Flush();
+            if (std::exchange(failing_, false)) {
+                boost::json::value log_json = {{"where", "journal_write"}};
+                BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "journal recovered";
+            }
+        } catch (const std::exception& e) {
+            // Сбой записи не останавливает игру: события остаются в очереди и пишутся
+            // повторно при следующем сбросе. В лог попадает только первая ошибка серии
+            if (!std::exchange(failing_, true)) {
+                boost::json::value log_json = {{"text", e.what()}, {"where", "journal_write"}};
+                BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "error";
+            }
+        }
+    }
+}
+
+std::size_t Journal::WriteChunks(const std::vector<Chunk>& chunks) {
+    static auto& fsync_duration = metrics::Registry::Instance().GetHistogram(
+        "journal_fsync_duration_seconds", "Time to write and fsync one journal group commit");
+    static auto& bytes_written = metrics::Registry::Instance().GetCounter(
+        "journal_bytes_written_total", "Bytes written to the journal");
+    static auto& failures = metrics::Registry::Instance().GetCounter(
+        "journal_write_failures_total", "Journal group commits that failed");
+
+    if (chunks.empty()) {
+        return 0;
+    }
+
+    metrics::ScopedTimer timer{fsync_duration};
+
+    // Группы до durable уже на диске: их сегменты закрыты после успешного fsync.
+    // Группы после durable пишутся в открытый сегмент, который при ошибке
+    // обрезается до durable_size_, чтобы за оборванной записью ничего не оказалось
+    std::size_t durable = 0;
+
+    const auto fail = [this, &durable](const std::string& what) {
+        failures.Add();
+        write_error_ = what + ": " + std::strerror(errno);
+        if (fd_ >= 0 && ::ftruncate(fd_, static_cast<off_t>(durable_size_)) != 0) {
+            // сегмент не удалось обрезать: до успешной обрезки в него ничего не пишется
+            needs_truncate_ = true;
+        }
+        return durable;
+    };
+
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        const auto& chunk = chunks[i];
+
+        if (fd_ >= 0 && needs_truncate_) {
+            if (::ftruncate(fd_, static_cast<off_t>(durable_size_)) != 0) {
+                return fail("Cannot truncate journal segment");
+            }
+            needs_truncate_ = false;
+        }
+
+        if (fd_ >= 0 && fd_segment_ != chunk.segment) {
+            if (::fsync(fd_) != 0) {
+                return fail("Cannot flush journal");
+            }
+            ::close(fd_);
+            fd_ = -1;
+            durable = i;
+        }
+
+        if (fd_ < 0) {
+            fd_ = ::open(SegmentPath(settings_.path, chunk.segment).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+            if (fd_ < 0) {
+                return fail("Cannot open journal segment");
+            }
+            fd_segment_ = chunk.segment;
+            struct stat st{};
+            if (::fstat(fd_, &st) != 0) {
+                ::close(fd_);
+                fd_ = -1;
+                return fail("Cannot open journal segment");
+            }
+            durable_size_ = static_cast<std::uint64_t>(st.st_size);
+        }
+
+        std::string_view data = chunk.data;
+        while (!data.empty()) {
+            const ssize_t written = ::write(fd_, data.data(), data.size());
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return fail("Cannot write journal");
+            }
+            data.remove_prefix(static_cast<std::size_t>(written));
+        }
+    }
+
+    if (::fsync(fd_) != 0) {
+        return fail("Cannot flush journal");
+    }
+
+    std::size_t synced_bytes = 0;
+    for (std::size_t i = durable; i < chunks.size(); ++i) {
+        synced_bytes += chunks[i].data.size();
+    }
+    durable_size_ += synced_bytes;
+    for (const auto& chunk : chunks) {
+        bytes_written.Add(chunk.data.size());
+    }
+    return chunks.size();
+}
+
+std::uint64_t Journal::Replay(const std::string& path, std::uint64_t from,
+                              const std::function<void(const Event&)>& fn) {
+    std::uint64_t last = from;
+
+    for (auto segment : ListSegments(path)) {
+        if (segment < from) {
+            continue;
+        }
+        last = segment;
+
+        std::ifstream file(SegmentPath(path, segment), std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::string_view rest = data;
+
+        // Чтение останавливается на хвосте, недописанном из-за сбоя процесса.
+        // Следующий сегмент начат уже после перезапуска, поэтому его события
+        // применяются к состоянию без этого хвоста
+        while (auto event = DecodeRecord(rest)) {
+            fn(*event);
+        }
+        if (!rest.empty()) {
+            boost::json::value log_json = {{"segment", segment}, {"skipped_bytes", rest.size()}};
+            BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "journal tail skipped";
+        }
+    }
+
+    return last;
+}
+
+}  // namespace journal
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace journal {
+
+/*
+ *  Журнал событий, меняющих состояние игры. Между полными сохранениями
+ *  (контрольными точками) в него дописываются входы игроков, смены направления,
+ *  тики (с зерном генератора случайных чисел) и уходы собак на покой.
+ *  После сбоя состояние восстанавливается из последней контрольной точки
+ *  и повторного применения событий журнала.
+ *
+ *  Журнал разбит на сегменты <path>.<номер>. При снятии контрольной точки
+ *  начинается новый сегмент, а старые удаляются после записи файла состояния.
+ *  Каждая запись сегмента: размер, контрольная сумма и тело события.
+ */
+
+struct Settings {
+    std::string path;  // префикс имен файлов сегментов
+    std::chrono::milliseconds flush_interval{10};  // период группового fsync
+};
+
+struct JoinEvent {
+    std::uint64_t player_id;
+    int dog_id;
+    std::string token;
+    std::string name;
+    std::string map_id;
+    double x;
+    double y;
+};
+
+struct MoveEvent {
+    int dog_id;
+    std::string direction;
+};
+
+struct TickEvent {
+    int delta;
+    std::uint64_t seed;
+};
+
+struct RetireEvent {
+    int dog_id;
+};
+
+using Event = std::variant<JoinEvent, MoveEvent, TickEvent, RetireEvent>;
+
+// Дописывает в out запись события: размер, контрольная сумма и тело
+void EncodeRecord(std::string& out, const Event& event);
+
+// Читает запись события из начала data и сдвигает data за нее. Возвращает
+// std::nullopt, если запись неполная или повреждена (data при этом не меняется)
+std::optional<Event> DecodeRecord(std::string_view& data);
+
+// Получатель событий игры (журнал, запись сеанса)
+class EventSink {
+public:
+    virtual void Append(const Event& event) = 0;
+
+protected:
+    ~EventSink() = default;
+};
+
+// Передает события всем подключенным получателям
+class EventSinks final : public EventSink {
+public:
+    void Add(EventSink* sink) {
+        sinks_.push_back(sink);
+    }
+
+    void Remove(EventSink* sink) {
+        std::erase(sinks_, sink);
+    }
+
+    bool Empty() const noexcept {
+        return sinks_.empty();
+    }
+
+    void Append(const Event& event) override {
+        for (auto* sink : sinks_) {
+            sink->Append(event);
+        }
+    }
+
+private:
+    std::vector<EventSink*> sinks_;
+};
+
+class Journal final : public EventSink {
+public:
+    // Новые события пишутся в сегменты, начиная с segment
+    Journal(Settings settings, std::uint64_t segment);
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Дописывает накопленные события и останавливает поток записи
+    ~Journal();
+
+    // Добавляет событие в буфер. Вызывается в strand игры, на диск
+    // событие попадает при ближайшем групповом сбросе
+    void Append(const Event& event) override;
+
+    // Начинает новый сегмент и возвращает его номер. Все события
+    // до вызова остаются в предыдущих сегментах
+    std::uint64_t Rotate();
+
+    // Удаляет сегменты с номерами меньше segment (они вошли в контрольную точку)
+    void RemoveSegmentsBefore(std::uint64_t segment);
+
+    // Записывает буфер и дожидается fsync. При ошибке ввода-вывода выбрасывает
+    // std::runtime_error, а незаписанные события оставляет в буфере до следующего вызова
+    void Flush();
+
+    // Передает fn события всех сегментов с номерами не меньше from по порядку.
+    // Чтение сегмента останавливается на первой неполной или поврежденной записи.
+    // Возвращает номер последнего прочитанного сегмента или from, если сегментов нет
+    static std::uint64_t Replay(const std::string& path, std::uint64_t from,
+                                const std::function<void(const Event&)>& fn);
+
+private:
+    struct Chunk {
+        std::uint64_t segment;
+        std::string data;
+    };
+
+    void Run(std::stop_token stop);
+    // Возвращает число групп, записанных и сброшенных на диск
+    std::size_t WriteChunks(const std::vector<Chunk>& chunks);
+
+    Settings settings_;
+
+    std::mutex mutex_;
+    std::condition_variable_any cond_var_;
+    std::vector<Chunk> pending_;
+    std::uint64_t segment_;
+
+    // принадлежат потоку записи (или Flush под io_mutex_)
+    std::mutex io_mutex_;
+    int fd_ = -1;
+    std::uint64_t fd_segment_ = 0;
+    std::uint64_t durable_size_ = 0;   // размер открытого сегмента после последнего fsync
+    bool needs_truncate_ = false;
+    std::string write_error_;
+    bool failing_ = false;             // только в потоке записи
+
+    std::jthread writer_;
+};
+
+}  // namespace journal
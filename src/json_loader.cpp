@@ -73,8 +73,6 @@ void AddOffice(model::Map& to_add, boost::json::object& office_obj) {
 }
 
 model::Game LoadGame(const std::filesystem::path& json_path) {
-    model::Game game;
-
     std::ifstream in(json_path);
     
     if (!in) {
@@ -83,9 +81,13 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
     
     std::stringstream buffer;
     buffer << in.rdbuf();
-    std::string str = buffer.str();
+    return ParseGame(buffer.str());
+}
+
+model::Game ParseGame(std::string_view config) {
+    model::Game game;
     
-    boost::json::value val = boost::json::parse(str);
+    boost::json::value val = boost::json::parse(config);
     boost::json::object json = val.as_object();
     
     if (json.count(KEY_DEFAULT_DOG_SPEED)) {
@@ -105,6 +107,10 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
         game.SetRetireTime(60000);
     }
     
+    if (json.count(KEY_MAX_DOGS_PER_SESSION)) {
+        game.SetMaxSessionDogs(static_cast<int>(json[KEY_MAX_DOGS_PER_SESSION].as_int64()));
+    }
+    
     for (const auto& map : json[KEY_MAPS].as_array()) {
         boost::json::object map_obj = map.as_object();
         
@@ -139,25 +145,20 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
         }
         
         boost::json::array loots = map_obj[KEY_LOOT_TYPES].as_array();
-        to_add.SetNumberOfLootOptions(static_cast<int>(loots.size()));
-        
-        std::unordered_map<std::string, int> name_of_loot_to_number;
-        std::unordered_map<int, int> number_of_loot_to_value;
-        int counter = 0;
-        
-        std::string tag = ExtraData::NameHelper({std::string(map_obj[KEY_ID].as_string()), TAG_LOOT_TYPES});
         
+        model::LootTypes loot_types;
+        loot_types.reserve(loots.size());
         for (const auto& loot : loots) {
             boost::json::object loot_obj = loot.as_object();
             
-            ExtraData::Store(tag, boost::json::serialize(loot));
-            name_of_loot_to_number[std::string(loot_obj[KEY_LOOT_NAME].as_string())] = counter;
-            number_of_loot_to_value[counter] = static_cast<int>(loot_obj[KEY_LOOT_VALUE].as_int64());
-            ++counter;
+            loot_types.push_back(model::LootType{
+                std::string(loot_obj[KEY_LOOT_NAME].as_string()),
+                static_cast<int>(loot_obj[KEY_LOOT_VALUE].as_int64()),
+                boost::json::serialize(loot)
+            });
         }
         
-        to_add.SetNamesOfLootsToNumbers(name_of_loot_to_number);
-        to_add.SetNumberOfLootsToValue(number_of_loot_to_value);
+        to_add.SetLootTypes(std::move(loot_types));
         
         game.AddMap(to_add);
     }
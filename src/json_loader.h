@@ -1,15 +1,16 @@
 #pragma once
 
 #include <filesystem>
+#include <string_view>
 
 #include "model.h"
-#include "extra_data.h"
 
 namespace json_loader {
 
 const std::string KEY_DEFAULT_DOG_SPEED = "defaultDogSpeed";
 const std::string KEY_DEFAULT_BAG_CAPACITY = "defaultBagCapacity";
 const std::string KEY_DOG_RETIREMENT_TIME = "dogRetirementTime";
+const std::string KEY_MAX_DOGS_PER_SESSION = "maxDogsPerSession";
 const std::string KEY_MAPS = "maps";
 const std::string KEY_ID = "id";
 const std::string KEY_NAME = "name";
@@ -34,8 +35,10 @@ const std::string KEY_OFFSET_X = "offsetX";
 const std::string KEY_OFFSET_Y = "offsetY";
 const std::string KEY_LOOT_NAME = "name";
 const std::string KEY_LOOT_VALUE = "value";
-const std::string TAG_LOOT_TYPES = "lootTypes";
 
 model::Game LoadGame(const std::filesystem::path& json_path);
 
+// Разбирает содержимое файла конфигурации (например, сохраненное в записи сеанса)
+model::Game ParseGame(std::string_view config);
+
 }
@@ -1,5 +1,106 @@
 #include "log.h"
 
+#include "mpsc_queue.h"
+
+#include <boost/log/sinks/unlocked_frontend.hpp>
+#include <boost/log/sinks/basic_sink_backend.hpp>
+
+#include <atomic>
+#include <thread>
+
+namespace {
+
+// Бэкенд, который только кладет запись в очередь. Форматирование и вывод
+// выполняются в отдельном потоке, поэтому потоки сервера не ждут std::cout
+class AsyncLogBackend : public sinks::basic_sink_backend<sinks::concurrent_feeding> {
+public:
+    AsyncLogBackend(std::ostream& out, const LogSettings& settings)
+        : out_(out)
+        , queue_(settings.queue_size)
+        , overflow_policy_(settings.overflow_policy)
+        , writer_([this] { Run(); }) {
+    }
+
+    AsyncLogBackend(const AsyncLogBackend&) = delete;
+    AsyncLogBackend& operator=(const AsyncLogBackend&) = delete;
+
+    ~AsyncLogBackend() {
+        Stop();
+    }
+
+    void consume(logging::record_view const& rec) {
+        logging::record_view record = rec;
+
+        while (!queue_.TryPush(record)) {
+            if (overflow_policy_ == LogOverflowPolicy::DROP || stop_.load(std::memory_order_acquire)) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    void Stop() {
+        if (!stop_.exchange(true, std::memory_order_acq_rel) && writer_.joinable()) {
+            writer_.join();
+        }
+    }
+
+    std::uint64_t GetDropped() const noexcept {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+private:
+    // максимальное число записей в одной пачке
+    static constexpr std::size_t MAX_BATCH = 256;
+    // пауза потока записи, когда очередь пуста
+    static constexpr auto IDLE_INTERVAL = 5ms;
+
+    void Run() {
+        std::string batch;
+        logging::formatting_ostream strm(batch);
+        logging::record_view record;
+
+        for (;;) {
+            const bool stopping = stop_.load(std::memory_order_acquire);
+
+            std::size_t count = 0;
+            while (count < MAX_BATCH && queue_.TryPop(record)) {
+                MyFormatter(record, strm);
+                strm << '\n';
+                ++count;
+            }
+
+            if (count > 0) {
+                strm.flush();
+                out_.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+                out_.flush();
+                batch.clear();
+                continue;
+            }
+
+            if (stopping) {
+                break;
+            }
+
+            std::this_thread::sleep_for(IDLE_INTERVAL);
+        }
+    }
+
+    std::ostream& out_;
+    util::BoundedMpscQueue<logging::record_view> queue_;
+    LogOverflowPolicy overflow_policy_;
+    std::atomic<bool> stop_{false};
+    std::atomic<std::uint64_t> dropped_{0};
+    std::thread writer_;
+};
+
+using AsyncLogSink = sinks::unlocked_sink<AsyncLogBackend>;
+
+boost::shared_ptr<AsyncLogSink> async_sink;
+
+} // namespace
+
 void MyFormatter(logging::record_view const& rec, logging::formatting_ostream& strm) {
 
     boost::json::object result;
@@ -16,13 +117,24 @@ void MyFormatter(logging::record_view const& rec, logging::formatting_ostream& s
     strm << boost::json::serialize(result);
 }
 
-void InitBoostLogFilter() {
+void InitBoostLogFilter(const LogSettings& settings) {
     logging::add_common_attributes();
 
-    logging::add_console_log(
-        std::cout,
-        keywords::format = &MyFormatter,
-        keywords::auto_flush = true
-    );
+    auto backend = boost::make_shared<AsyncLogBackend>(std::cout, settings);
+    async_sink = boost::make_shared<AsyncLogSink>(backend);
+    
+    logging::core::get()->add_sink(async_sink);
+}
+
+void StopBoostLog() {
+    if (!async_sink) {
+        return;
+    }
+    
+    logging::core::get()->remove_sink(async_sink);
+    async_sink->locked_backend()->Stop();
 }
 
+std::uint64_t GetDroppedLogRecords() {
+    return async_sink ? async_sink->locked_backend()->GetDropped() : 0;
+}
@@ -13,6 +13,8 @@
 
 #include <string_view>
 #include <iostream>
+#include <cstdint>
+#include <cstddef>
 
 using namespace std::literals;
 namespace logging = boost::log;
@@ -26,5 +28,39 @@ BOOST_LOG_ATTRIBUTE_KEYWORD(line_id, "LineID", unsigned int)
 BOOST_LOG_ATTRIBUTE_KEYWORD(timestamp, "TimeStamp", boost::posix_time::ptime)
 BOOST_LOG_ATTRIBUTE_KEYWORD(additional_data, "AdditionalData",boost::json::value)
 
+// Что делать с записью, если очередь асинхронного лога заполнена
+enum class LogOverflowPolicy {
+    DROP,   // отбросить запись и увеличить счетчик потерянных записей
+    BLOCK   // ждать, пока поток записи освободит место
+};
+
+struct LogSettings {
+    std::size_t queue_size = 8192;
+    LogOverflowPolicy overflow_policy = LogOverflowPolicy::BLOCK;
+};
+
 void MyFormatter(logging::record_view const& rec, logging::formatting_ostream& strm);
-void InitBoostLogFilter();
+
+// Записи лога складываются в неблокирующую кольцевую очередь, а форматируются
+// и пишутся в std::cout пачками в отдельном потоке
+void InitBoostLogFilter(const LogSettings& settings = {});
+
+// Дописывает накопленные записи и останавливает поток записи.
+// Повторный вызов ничего не делает
+void StopBoostLog();
+
+// Вызывает StopBoostLog при выходе из области видимости, чтобы записи
+// из очереди дописывались на любом пути завершения
+class BoostLogGuard {
+public:
+    BoostLogGuard() = default;
+    BoostLogGuard(const BoostLogGuard&) = delete;
+    BoostLogGuard& operator=(const BoostLogGuard&) = delete;
+
+    ~BoostLogGuard() {
+        StopBoostLog();
+    }
+};
+
+// Количество записей, отброшенных из-за переполнения очереди
+std::uint64_t GetDroppedLogRecords();
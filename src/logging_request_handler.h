@@ -1,6 +1,10 @@
 #pragma once
 
+#include <type_traits>
+
+#include "http_capture.h"
 #include "request_handler.h"
+#include "trace.h"
 
 namespace beast = boost::beast;
 namespace http = beast::http;
@@ -12,20 +16,66 @@ template<class SomeRequestHandler>
 class LoggingRequestHandler {
 public:
 
-    explicit LoggingRequestHandler(SomeRequestHandler& handler) : decorated_{handler} {}
+    // capture - запись входящих запросов (--capture-http), может отсутствовать
+    explicit LoggingRequestHandler(SomeRequestHandler& handler, http_capture::Writer* capture = nullptr)
+    : decorated_{handler}, capture_{capture} {}
     
     template <typename Body, typename Allocator, typename Send>
     void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, const tcp::endpoint& remote_endpoint, Send&& send) {
         
+        TRACE_SPAN("http.handle_request");
+        
         // log request
         boost::json::value log_json_req = {{"ip", remote_endpoint.address().to_string()}, {"URI", static_cast<std::string>(req.target())}, {"method", req.method_string()}};
         BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json_req) << "request received";
         
         auto start = std::chrono::high_resolution_clock::now();
         
-        decorated_(std::move(req), std::move(send), start);
+        if (!capture_) {
+            decorated_(std::move(req), std::move(send), start);
+            return;
+        }
+        
+        const auto request_id = Capture(req, remote_endpoint);
+        if (req.target() != api_handler::REQUEST_JOIN) {
+            decorated_(std::move(req), std::move(send), start);
+            return;
+        }
+        
+        // токен из ответа на вход нужен game_replay, чтобы подменить его в следующих запросах
+        decorated_(std::move(req), [send = std::forward<Send>(send), capture = capture_, request_id](auto&& response) {
+            using Response = std::decay_t<decltype(response)>;
+            if constexpr (std::is_same_v<Response, StringResponse>) {
+                if (response.result() == http::status::ok) {
+                    try {
+                        const auto& body = boost::json::parse(response.body()).as_object();
+                        capture->AppendToken(request_id, body.at("authToken").as_string());
+                    } catch (const std::exception&) {
+                        // ответ без токена не мешает обработке запроса
+                    }
+                }
+            }
+            send(std::forward<decltype(response)>(response));
+        }, start);
     }
     
 private:
+    template <typename Request>
+    std::uint64_t Capture(const Request& req, const tcp::endpoint& remote_endpoint) {
+        std::vector<std::pair<std::string, std::string>> headers;
+        for (const auto& field : req) {
+            headers.emplace_back(std::string(field.name_string()), std::string(field.value()));
+        }
+        
+        std::string_view body;
+        if constexpr (std::is_same_v<typename Request::body_type, http::string_body>) {
+            body = req.body();
+        }
+        
+        const auto connection = remote_endpoint.address().to_string() + ":" + std::to_string(remote_endpoint.port());
+        return capture_->AppendRequest(connection, req.method_string(), req.target(), std::move(headers), body);
+    }
+    
      SomeRequestHandler& decorated_;
+     http_capture::Writer* capture_;
 };
@@ -35,6 +35,23 @@ public:
      */
     unsigned Generate(TimeInterval time_delta, unsigned loot_count, unsigned looter_count);
     
+    // Время, прошедшее с последнего появления трофеев (сохраняется вместе с состоянием игры)
+    TimeInterval GetTimeWithoutLoot() const noexcept {
+        return time_without_loot_;
+    }
+    
+    void SetTimeWithoutLoot(TimeInterval time) noexcept {
+        time_without_loot_ = time;
+    }
+    
+    TimeInterval GetBaseInterval() const noexcept {
+        return base_interval_;
+    }
+    
+    double GetProbability() const noexcept {
+        return probability_;
+    }
+    
 private:
     static double DefaultGenerator() noexcept {
         return 1.0;
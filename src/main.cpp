@@ -8,12 +8,27 @@
 #include <thread>
 #include <chrono>
 #include <optional>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <mutex>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 #include "log.h"
 #include "json_loader.h"
 #include "request_handler.h"
 #include "logging_request_handler.h"
 #include "ticker.h"
+#include "metrics.h"
+#include "journal.h"
+#include "map_pack.h"
+#include "config_reloader.h"
+#include "simulation.h"
 
 using namespace std::literals;
 namespace net = boost::asio;
@@ -36,6 +51,47 @@ void RunWorkers(unsigned n, const Fn& fn) {
     fn();
 }
 
+// Ядра, на которых процессу разрешено работать. В контейнере с cpuset это
+// не обязательно первые hardware_concurrency() ядер. Пусто, если узнать не удалось
+std::vector<unsigned> AllowedCpus() {
+    std::vector<unsigned> cpus;
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+        for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &cpu_set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return cpus;
+}
+
+// Привязывает текущий поток к ядрам cpus. Возвращает false, если это не удалось
+bool PinCurrentThread(const std::vector<unsigned>& cpus) {
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (unsigned cpu : cpus) {
+        CPU_SET(cpu, &cpu_set);
+    }
+    return !cpus.empty() && pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+    return false;
+#endif
+}
+
+void LogPinFailure(std::string_view thread, const std::vector<unsigned>& cpus) {
+    boost::json::array cpus_json;
+    for (unsigned cpu : cpus) {
+        cpus_json.emplace_back(cpu);
+    }
+    boost::json::value log_json = {{"text", "cannot pin thread to cpus"}, {"thread", thread}, {"cpus", cpus_json}};
+    BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "warning";
+}
+
 }  // namespace
 
 struct Args {
@@ -45,19 +101,62 @@ struct Args {
     bool randomize_spawn_points;
     std::string state_file;
     int save_state_period = 0;
+    bool journal = false;
+    std::string record_file;
+    std::string capture_file;
+    int journal_flush_interval = 10;
+    Ticker::Settings tick_settings;
+    bool sim_thread = false;
+    std::optional<unsigned short> admin_port;
+    LogSettings log_settings;
+    std::optional<simulation::Settings> simulate;
 };
 
+Ticker::CatchUpPolicy ParseCatchUpPolicy(const std::string& policy) {
+    if (policy == "skip"sv) {
+        return Ticker::CatchUpPolicy::SKIP;
+    }
+    if (policy == "coalesce"sv) {
+        return Ticker::CatchUpPolicy::COALESCE;
+    }
+    if (policy == "substeps"sv) {
+        return Ticker::CatchUpPolicy::SUBSTEPS;
+    }
+    throw std::runtime_error("ERROR:Unknown tick catch-up policy: "s + policy);
+}
+
 [[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
     po::options_description desc{"All options"s};
     Args args;
+    simulation::Settings sim_settings;
+    std::string sim_policy = "random";
+    unsigned sim_tick = 50;
     desc.add_options()
         ("help,h", "Show help")
         ("tick-period,t", po::value<int>(), "Tick period of server update")
+        ("tick-catch-up", po::value<std::string>(), "What to do with late ticks: skip, coalesce (default) or substeps")
+        ("tick-max-substeps", po::value(&args.tick_settings.max_substeps), "Max number of ticks run at once with substeps policy")
+        ("sim-thread", "Run the game loop on a dedicated thread pinned to the last core")
+        ("admin-port", po::value<unsigned short>(), "Serve /metrics and /debug/trace on 127.0.0.1 at this port")
         ("config-file,c", po::value(&args.config_file), "Config file path")
         ("www-root,w", po::value(&args.www_root), "Static www files path")
         ("randomize-spawn-points", "Spawn dogs in random map point")
         ("state-file", po::value(&args.state_file), "Set state file path")
-        ("save-state-period", po::value<int>(&args.save_state_period), "Set save state period");
+        ("save-state-period", po::value<int>(&args.save_state_period), "Set save state period")
+        ("journal", "Write game events to a journal next to the state file and replay it on start")
+        ("journal-flush-interval", po::value(&args.journal_flush_interval), "Journal group commit period in milliseconds")
+        ("record", po::value(&args.record_file), "Record config, initial state and game events for deterministic replay")
+        ("capture-http", po::value(&args.capture_file), "Write incoming HTTP requests to a file for replay with game_replay")
+        ("log-queue-size", po::value(&args.log_settings.queue_size), "Max number of log records waiting to be written")
+        ("log-drop-on-overflow", "Drop log records instead of waiting when the log queue is full")
+        ("simulate", "Run ticks headless as fast as possible with synthetic dogs, print performance and exit")
+        ("sim-dogs", po::value(&sim_settings.dogs), "Number of synthetic dogs in simulation (1000 by default)")
+        ("sim-ticks", po::value(&sim_settings.ticks), "Number of simulated ticks (1000 by default)")
+        ("sim-tick", po::value(&sim_tick), "Virtual tick length in milliseconds (50 by default)")
+        ("sim-policy", po::value(&sim_policy), "Dog movement in simulation: random (default) or patrol")
+        ("sim-turn-probability", po::value(&sim_settings.turn_probability), "Chance of a direction change per tick with random policy")
+        ("sim-map", po::value(&sim_settings.maps)->multitoken(), "Maps to spread dogs over (all maps by default)")
+        ("sim-seed", po::value(&sim_settings.seed), "Seed of simulation moves and ticks");
     
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -71,24 +170,56 @@ struct Args {
         throw std::runtime_error("ERROR:Config file must be specified."s);
     }
 
-    if (!vm.contains("www-root"s)) {
+    if (vm.contains("simulate"s)) {
+        sim_settings.policy = simulation::ParseMovePolicy(sim_policy);
+        sim_settings.tick = std::chrono::milliseconds(sim_tick);
+        if (sim_settings.tick.count() <= 0) {
+            throw std::runtime_error("ERROR:Simulation tick must be positive."s);
+        }
+        args.simulate = sim_settings;
+    } else if (!vm.contains("www-root"s)) {
         throw std::runtime_error("ERROR:Source root must be specified."s);
     }
 
     if (vm.count("tick-period"s)) {
         args.tick_period = vm["tick-period"].as<int>();
+        if (*args.tick_period <= 0) {
+            throw std::runtime_error("ERROR:Tick period must be positive."s);
+        }
     } else {
         args.tick_period = std::nullopt;
     }
 
+    if (vm.contains("tick-catch-up"s)) {
+        args.tick_settings.policy = ParseCatchUpPolicy(vm["tick-catch-up"].as<std::string>());
+    }
+
+    args.sim_thread = vm.contains("sim-thread"s);
+
+    if (vm.contains("admin-port"s)) {
+        args.admin_port = vm["admin-port"].as<unsigned short>();
+    }
+
     if (vm.count("randomize-spawn-points"s)) {
         args.randomize_spawn_points = true;
     } else {
         args.randomize_spawn_points = false;
     }
     
+    if (vm.contains("log-drop-on-overflow"s)) {
+        args.log_settings.overflow_policy = LogOverflowPolicy::DROP;
+    }
+    
+    args.journal = vm.contains("journal"s);
+    if (args.save_state_period < 0) {
+        throw std::runtime_error("ERROR:Save state period must not be negative."s);
+    }
+    
     // если не задан файл для сохранения
     if (!vm.contains("state-file")) {
+        if (args.journal) {
+            throw std::runtime_error("ERROR:Journal requires a state file."s);
+        }
         args.state_file = std::string();
         args.save_state_period = 0;
     }
@@ -105,15 +236,23 @@ int main(int argc, const char* argv[]) {
         } else {
             return EXIT_SUCCESS;
         }
+        InitBoostLogFilter(args.log_settings);
     } catch (const std::exception& e) {
         std::cout << e.what() << std::endl;
         return EXIT_FAILURE;
     }
+    const BoostLogGuard log_guard;
     
     try {
-        InitBoostLogFilter();
+        metrics::Registry::Instance().AddCallback(
+            "log_records_dropped_total", "Log records dropped because the log queue was full",
+            metrics::MetricType::COUNTER, [] { return static_cast<double>(GetDroppedLogRecords()); });
         
-        model::Game game = json_loader::LoadGame(args.config_file);
+        // скомпилированный набор карт отображается в память без разбора JSON
+        model::Game game = map_pack::IsMapPackFile(args.config_file)
+            ? map_pack::LoadMapPack(args.config_file)
+            : json_loader::LoadGame(args.config_file);
+        api_handler::PrepareMapResponses(*game.GetMapCatalog());
         
         game.SetSaveFile(args.state_file);
         
@@ -121,6 +260,8 @@ int main(int argc, const char* argv[]) {
             try {
                 game.LoadState();
             } catch (std::exception& e) {
+                boost::json::value log_json = {{"text", e.what()}, {"where", "load_state"}};
+                BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "error";
                 return EXIT_FAILURE;
             }
             std::cout << "trying to load state" << std::endl;
@@ -129,46 +270,103 @@ int main(int argc, const char* argv[]) {
         game.SetRandomizeSpawnPoint(args.randomize_spawn_points);
         game.SetTickPeriod(args.tick_period);
         
+        // безголовый прогон: без HTTP, БД, журнала и таймера
+        if (args.simulate) {
+            // отчет печатается после остановки лога, чтобы не смешиваться с его записями
+            std::ostringstream report;
+            simulation::Run(game, *args.simulate, report);
+            StopBoostLog();
+            std::cout << report.str() << std::flush;
+            return EXIT_SUCCESS;
+        }
+        
+        // события после контрольной точки повторяются до подключения к БД:
+        // рекорды ушедших на покой собак в ней уже есть
+        if (args.journal) {
+            game.EnableJournal({args.state_file + ".journal",
+                                std::chrono::milliseconds(args.journal_flush_interval)});
+        }
+        
+        // запись начинается с состояния после загрузки и повтора журнала
+        if (!args.record_file.empty()) {
+            std::ifstream config(args.config_file, std::ios::binary);
+            const std::string config_data((std::istreambuf_iterator<char>(config)), std::istreambuf_iterator<char>());
+            game.StartRecording(args.record_file, config_data);
+        }
+        
         // загрузка БД
         const unsigned num_threads = std::thread::hardware_concurrency();
         
+        // без GAME_DB_URL рекорды хранятся в памяти (локальный запуск, нагрузочные тесты)
         const char* db_url = std::getenv("GAME_DB_URL");
-        if (!db_url) {
-            throw std::runtime_error("GAME_DB_URL is not specified");
-        }
-        auto connection_pool = std::make_shared<ConnectionPool>(std::max(1u, num_threads), [db_url] {
-            return std::make_shared<pqxx::connection>(db_url);
-        });
-        try{
-            postgres::DB::Init(connection_pool);
-            game.SetPool(connection_pool);
-        } catch (std::exception& e) {
-            return EXIT_FAILURE;
+        if (db_url) {
+            auto connection_pool = std::make_shared<ConnectionPool>(std::max(1u, num_threads), [db_url] {
+                return std::make_shared<pqxx::connection>(db_url);
+            });
+            try{
+                postgres::DB::Init(connection_pool);
+                game.SetRecordStore(std::make_shared<postgres::PostgresRecordStore>(connection_pool));
+            } catch (std::exception& e) {
+                boost::json::value log_json = {{"text", e.what()}, {"where", "db_init"}};
+                BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "error";
+                return EXIT_FAILURE;
+            }
+        } else {
+            boost::json::value log_json = {{"text", "GAME_DB_URL is not specified, records are kept in memory"}};
+            BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "warning";
+            game.SetRecordStore(std::make_shared<postgres::InMemoryRecordStore>());
         }
         
         // 2. Инициализируем io_context
         net::io_context ioc(num_threads);
+        
+        // Игровой цикл может работать в отдельном io_context на своем потоке.
+        // С HTTP-частью он связан только strand игры, очередями действий и снимками сессий,
+        // поэтому нагрузка на сокеты не сдвигает тики, а тяжелый тик не задерживает ввод-вывод
+        net::io_context sim_ioc(1);
+        auto sim_work = net::make_work_guard(sim_ioc);
+        
+        // Служебные маршруты (/metrics, /debug/trace) не требуют авторизации, поэтому
+        // слушают только loopback и работают в своем потоке: выгрузка трассировки
+        // не занимает потоки игрового порта
+        net::io_context admin_ioc(1);
 
         // 3. Добавляем асинхронный обработчик сигналов SIGINT и SIGTERM
         net::signal_set signals(ioc, SIGINT, SIGTERM);
-        signals.async_wait([&ioc](const sys::error_code& ec, [[maybe_unused]] int signal_number) {
+        signals.async_wait([&ioc, &sim_ioc, &admin_ioc](const sys::error_code& ec, [[maybe_unused]] int signal_number) {
             if (!ec) {
                 
                 boost::json::value log_json = {{"code", 0}};
                 BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "server exited";
                 
                 ioc.stop();
+                sim_ioc.stop();
+                admin_ioc.stop();
             }
         });
         
-        auto api_strand = net::make_strand(ioc);
+        auto api_strand = net::make_strand(args.sim_thread ? sim_ioc : ioc);
+
+        // По SIGHUP карты перечитываются из --config-file без остановки сервера
+        ConfigReloader reloader(game, api_strand, args.config_file);
+        net::signal_set reload_signals(ioc, SIGHUP);
+        std::function<void()> wait_reload = [&] {
+            reload_signals.async_wait([&](const sys::error_code& ec, [[maybe_unused]] int signal_number) {
+                if (!ec) {
+                    reloader.Reload();
+                    wait_reload();
+                }
+            });
+        };
+        wait_reload();
 
         // Сервер автоматически обновляет время
         if (args.tick_period) {
             auto ticker = std::make_shared<Ticker>(
                 api_strand, std::chrono::milliseconds(args.tick_period.value()), [&game](std::chrono::milliseconds delta) {
                 game.UpdateTickState(delta);
-            }
+            },
+            args.tick_settings
             );
             ticker->Start();
         }
@@ -179,10 +377,12 @@ int main(int argc, const char* argv[]) {
             // нужна автоматическая сериализация
             if (args.tick_period) {
                 
+                // копия состояния снимается в strand игры, а записывается в фоновом потоке
                 auto ticker = std::make_shared<Ticker>(
-                    api_strand, std::chrono::milliseconds(args.save_state_period), [&game](std::chrono::milliseconds delta) {
-                    game.UpdateTickState(delta);
-                }
+                    api_strand, std::chrono::milliseconds(args.save_state_period), [&game]([[maybe_unused]] std::chrono::milliseconds delta) {
+                    game.SaveStateAsync();
+                },
+                Ticker::Settings{.name = "save_state"}
                 );
                 ticker->Start();
                 
@@ -195,8 +395,14 @@ int main(int argc, const char* argv[]) {
         }
         
         // 4. Создаём обработчик HTTP-запросов и связываем его с моделью игры
-        auto handler_tmp = std::make_shared<http_handler::RequestHandler>(game, argv[2], api_strand);
-        LoggingRequestHandler<http_handler::RequestHandler> handler{*handler_tmp};
+        auto handler_tmp = std::make_shared<http_handler::RequestHandler>(game, args.www_root, api_strand);
+        
+        // запись входящих запросов дописывается в файл при разрушении, после остановки сервера
+        std::unique_ptr<http_capture::Writer> capture;
+        if (!args.capture_file.empty()) {
+            capture = std::make_unique<http_capture::Writer>(args.capture_file);
+        }
+        LoggingRequestHandler<http_handler::RequestHandler> handler{*handler_tmp, capture.get()};
         
         // 5. Запустить обработчик HTTP-запросов, делегируя их обработчику запросов
         const auto address = net::ip::make_address("0.0.0.0");
@@ -208,21 +414,83 @@ int main(int argc, const char* argv[]) {
         
         boost::json::value log_json = {{"port", 8080}, {"address", "0.0.0.0"}};
         BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "server started";
+        
+        std::jthread admin_thread;
+        if (args.admin_port) {
+            http_server::ServeHttp(admin_ioc, {net::ip::address_v4::loopback(), *args.admin_port},
+                                   http_handler::AdminRequestHandler{});
+            admin_thread = std::jthread([&admin_ioc] {
+                admin_ioc.run();
+            });
+            
+            boost::json::value admin_log_json = {{"port", *args.admin_port}, {"address", "127.0.0.1"}};
+            BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, admin_log_json) << "admin server started";
+        }
 
         // 6. Запускаем обработку асинхронных операций
-        RunWorkers(std::max(1u, num_threads), [&ioc] {
+        // С --sim-thread игровому циклу отдается последнее разрешенное процессу ядро,
+        // а потоки HTTP привязываются к остальным, чтобы не вытеснять его
+        std::jthread sim_thread;
+        unsigned http_threads = num_threads;
+        std::vector<unsigned> http_cpus;
+        if (args.sim_thread) {
+            std::vector<unsigned> sim_cpus;
+            http_cpus = AllowedCpus();
+            if (http_cpus.size() >= 2) {
+                sim_cpus.push_back(http_cpus.back());
+                http_cpus.pop_back();
+                http_threads = static_cast<unsigned>(http_cpus.size());
+            } else {
+                // на одном ядре отдельного ядра для игры нет, потоки не привязываются
+                boost::json::value log_json = {{"text", "sim thread is not pinned: fewer than 2 cpus allowed"},
+                                               {"cpus", http_cpus.size()}};
+                BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "warning";
+                http_cpus.clear();
+                http_threads = std::max(1u, num_threads - 1);
+            }
+            
+            sim_thread = std::jthread([&sim_ioc, sim_cpus] {
+                if (!sim_cpus.empty() && !PinCurrentThread(sim_cpus)) {
+                    LogPinFailure("sim", sim_cpus);
+                }
+                sim_ioc.run();
+            });
+        }
+        
+        std::once_flag http_pin_failure;
+        RunWorkers(std::max(1u, http_threads), [&ioc, &http_cpus, &http_pin_failure] {
+            if (!http_cpus.empty() && !PinCurrentThread(http_cpus)) {
+                std::call_once(http_pin_failure, LogPinFailure, "http", std::cref(http_cpus));
+            }
             ioc.run();
         });
         
+        admin_ioc.stop();
+        
+        // сохранять состояние можно только после остановки игрового цикла
+        sim_ioc.stop();
+        if (sim_thread.joinable()) {
+            sim_thread.join();
+        }
+        
+        game.StopRecording();
+        
         if (args.state_file.size() != 0) {
             try {
                 game.SaveState();
             } catch (const std::exception& e) {
-                std::cout << e.what() << std::endl;
+                boost::json::value log_json = {{"text", e.what()}, {"where", "save_state"}};
+                BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "error";
                 return EXIT_FAILURE;
             }
         }
         
+        // счетчик окончателен только после остановки потока записи
+        StopBoostLog();
+        if (auto dropped = GetDroppedLogRecords()) {
+            std::cout << "log records dropped: " << dropped << std::endl;
+        }
+        
     } catch (const std::exception& ex) {
         
         boost::json::value log_json = {{"code", EXIT_FAILURE}, {"exception", ex.what()}};
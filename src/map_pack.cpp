@@ -0,0 +1,380 @@
+#include "map_pack.h"
+
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "byte_codec.h"
+
+namespace map_pack {
+
+static_assert(std::endian::native == std::endian::little, "Map pack format is little-endian");
+
+namespace {
+
+using codec::SectionEntry;
+using codec::StringRef;
+
+constexpr codec::Magic MAGIC = {'G', 'S', 'M', 'A', 'P', 'P', 'K', '\0'};
+constexpr std::string_view FORMAT = "map pack";
+
+enum class Section : std::uint32_t {
+    GAME,
+    MAPS,
+    ROADS,
+    BUILDINGS,
+    OFFICES,
+    LOOT_TYPES,
+    STRINGS,
+    COUNT
+};
+
+constexpr std::size_t SECTION_COUNT = static_cast<std::size_t>(Section::COUNT);
+
+// Диапазон записей в секции
+struct Range {
+    std::uint32_t begin;
+    std::uint32_t count;
+};
+
+// Параметры игры (одна запись)
+struct GameRecord {
+    double default_dog_speed;
+    std::int32_t default_bag_capacity;
+    std::int32_t retire_time;  // мс
+    std::int64_t loot_period;  // мс, 0 - генератор не задан
+    double loot_probability;
+    std::int32_t max_session_dogs;  // 0 - без ограничения
+    std::uint32_t reserved;
+};
+
+struct MapRecord {
+    StringRef id;
+    StringRef name;
+    double dog_speed;
+    std::int32_t bag_capacity;
+    std::uint32_t reserved;
+    Range roads;
+    Range buildings;
+    Range offices;
+    Range loot_types;
+};
+
+struct RoadRecord {
+    std::int32_t x0;
+    std::int32_t y0;
+    std::int32_t end;       // x1 для горизонтальной дороги, y1 для вертикальной
+    std::int32_t vertical;
+};
+
+struct BuildingRecord {
+    std::int32_t x;
+    std::int32_t y;
+    std::int32_t w;
+    std::int32_t h;
+};
+
+struct OfficeRecord {
+    StringRef id;
+    std::int32_t x;
+    std::int32_t y;
+    std::int32_t offset_x;
+    std::int32_t offset_y;
+};
+
+// Тип лута с номером, равным индексу в диапазоне карты
+struct LootTypeRecord {
+    StringRef name;
+    StringRef json;
+    std::int32_t value;
+    std::uint32_t reserved;
+};
+
+static_assert(std::is_trivially_copyable_v<GameRecord> && std::is_trivially_copyable_v<MapRecord>
+              && std::is_trivially_copyable_v<RoadRecord> && std::is_trivially_copyable_v<BuildingRecord>
+              && std::is_trivially_copyable_v<OfficeRecord> && std::is_trivially_copyable_v<LootTypeRecord>);
+
+constexpr std::array<std::size_t, SECTION_COUNT> RECORD_SIZES = {
+    sizeof(GameRecord), sizeof(MapRecord), sizeof(RoadRecord), sizeof(BuildingRecord),
+    sizeof(OfficeRecord), sizeof(LootTypeRecord), 1
+};
+
+using Reader = codec::SectionReader<Section, SECTION_COUNT>;
+
+void CheckRange(const Reader& reader, Section kind, Range range) {
+    reader.GetRecords(kind, range.begin, range.count);
+}
+
+// Файл, отображенный в память только для чтения
+class MappedFile {
+public:
+    explicit MappedFile(const std::filesystem::path& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open map pack: " + std::string(std::strerror(errno)));
+        }
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat map pack: " + std::string(std::strerror(errno)));
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+
+        if (size_ > 0) {
+            data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        if (data_ == MAP_FAILED) {
+            data_ = nullptr;
+            throw std::runtime_error("Cannot map map pack: " + std::string(std::strerror(errno)));
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (data_) {
+            ::munmap(data_, size_);
+        }
+    }
+
+    std::string_view View() const noexcept {
+        return data_ ? std::string_view(static_cast<const char*>(data_), size_) : std::string_view{};
+    }
+
+private:
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+} // namespace
+
+bool MapPack::IsMapPack(std::string_view data) noexcept {
+    return codec::HasMagic(data, MAGIC);
+}
+
+std::string MapPack::Encode(const model::Game& game) {
+    const auto& maps = game.GetMaps();
+
+    std::size_t roads_count = 0;
+    std::size_t buildings_count = 0;
+    std::size_t offices_count = 0;
+    std::size_t loot_types_count = 0;
+    std::size_t strings_size = 0;
+
+    for (std::size_t i = 0; i < maps.size(); ++i) {
+        const auto& map = *maps[i];
+
+        roads_count += map.GetRoads().size();
+        buildings_count += map.GetBuildings().size();
+        offices_count += map.GetOffices().size();
+        strings_size += (*map.GetId()).size() + map.GetName().size();
+        for (const auto& office : map.GetOffices()) {
+            strings_size += (*office.GetId()).size();
+        }
+
+        for (const auto& type : map.GetLootTypes()) {
+            strings_size += type.name.size() + type.json.size();
+        }
+        loot_types_count += map.GetLootTypes().size();
+    }
+
+    std::array<SectionEntry, SECTION_COUNT> sections{};
+    const auto layout = [&sections](Section kind, std::size_t count, std::size_t offset) {
+        return codec::LayoutSection(sections, kind, RECORD_SIZES[static_cast<std::size_t>(kind)], count, offset);
+    };
+
+    std::size_t offset = codec::FirstSectionOffset(SECTION_COUNT);
+    offset = layout(Section::GAME, 1, offset);
+    offset = layout(Section::MAPS, maps.size(), offset);
+    offset = layout(Section::ROADS, roads_count, offset);
+    offset = layout(Section::BUILDINGS, buildings_count, offset);
+    offset = layout(Section::OFFICES, offices_count, offset);
+    offset = layout(Section::LOOT_TYPES, loot_types_count, offset);
+    offset = layout(Section::STRINGS, strings_size, offset);
+
+    if (strings_size > UINT32_MAX || roads_count > UINT32_MAX || buildings_count > UINT32_MAX) {
+        throw std::runtime_error("Maps are too large for the map pack format");
+    }
+
+    std::string buffer(offset, '\0');
+
+    const auto put = [&buffer, &sections](Section kind, std::size_t index, const auto& record) {
+        codec::PutAt(buffer, codec::RecordOffset(sections, kind, index), record);
+    };
+
+    std::size_t next_string = 0;
+    const auto& strings_section = sections[static_cast<std::size_t>(Section::STRINGS)];
+    const auto put_string = [&](std::string_view str) {
+        StringRef ref{static_cast<std::uint32_t>(next_string), static_cast<std::uint32_t>(str.size())};
+        codec::PutBytesAt(buffer, strings_section.offset + next_string, str);
+        next_string += str.size();
+        return ref;
+    };
+
+    GameRecord game_record{};
+    game_record.default_dog_speed = game.GetSpeed();
+    game_record.default_bag_capacity = game.GetBagCapacity();
+    game_record.retire_time = game.GetRetireTime();
+    game_record.max_session_dogs = game.GetMaxSessionDogs();
+    if (auto generator = game.GetGenerator()) {
+        game_record.loot_period = generator->GetBaseInterval().count();
+        game_record.loot_probability = generator->GetProbability();
+    }
+    put(Section::GAME, 0, game_record);
+
+    std::uint32_t next_road = 0;
+    std::uint32_t next_building = 0;
+    std::uint32_t next_office = 0;
+    std::uint32_t next_loot_type = 0;
+
+    for (std::size_t i = 0; i < maps.size(); ++i) {
+        const auto& map = *maps[i];
+
+        MapRecord record{};
+        record.id = put_string(*map.GetId());
+        record.name = put_string(map.GetName());
+        record.dog_speed = map.GetSpeed();
+        record.bag_capacity = static_cast<std::int32_t>(map.GetCapacity());
+
+        record.roads = {next_road, static_cast<std::uint32_t>(map.GetRoads().size())};
+        for (const auto& road : map.GetRoads()) {
+            const auto start = road.GetStart();
+            const auto end = road.GetEnd();
+            const bool vertical = road.IsVertical();
+            put(Section::ROADS, next_road++,
+                RoadRecord{start.x, start.y, vertical ? end.y : end.x, vertical ? 1 : 0});
+        }
+
+        record.buildings = {next_building, static_cast<std::uint32_t>(map.GetBuildings().size())};
+        for (const auto& building : map.GetBuildings()) {
+            const auto& bounds = building.GetBounds();
+            put(Section::BUILDINGS, next_building++,
+                BuildingRecord{bounds.position.x, bounds.position.y, bounds.size.width, bounds.size.height});
+        }
+
+        record.offices = {next_office, static_cast<std::uint32_t>(map.GetOffices().size())};
+        for (const auto& office : map.GetOffices()) {
+            OfficeRecord office_record{};
+            office_record.id = put_string(*office.GetId());
+            office_record.x = office.GetPosition().x;
+            office_record.y = office.GetPosition().y;
+            office_record.offset_x = office.GetOffset().dx;
+            office_record.offset_y = office.GetOffset().dy;
+            put(Section::OFFICES, next_office++, office_record);
+        }
+
+        record.loot_types = {next_loot_type, static_cast<std::uint32_t>(map.GetLootTypes().size())};
+        for (const auto& type : map.GetLootTypes()) {
+            LootTypeRecord type_record{};
+            type_record.name = put_string(type.name);
+            type_record.json = put_string(type.json);
+            type_record.value = type.value;
+            put(Section::LOOT_TYPES, next_loot_type++, type_record);
+        }
+
+        put(Section::MAPS, i, record);
+    }
+
+    codec::WriteFileHeader(buffer, MAGIC, MAP_PACK_VERSION, sections);
+
+    return buffer;
+}
+
+model::Game MapPack::Decode(std::string_view data) {
+    const auto header = codec::ReadFileHeader(data, MAGIC, FORMAT);
+
+    if (header.version != MAP_PACK_VERSION) {
+        throw std::runtime_error("Unsupported map pack version " + std::to_string(header.version)
+                                 + ", recompile it with map_compiler");
+    }
+    const auto sections = codec::ReadSectionTable(data, header, SECTION_COUNT, RECORD_SIZES, FORMAT);
+
+    Reader reader(data, sections, FORMAT);
+    model::Game game;
+
+    const auto game_record = reader.Get<GameRecord>(Section::GAME, 0);
+    game.AddSpeed(game_record.default_dog_speed);
+    game.AddCapacity(game_record.default_bag_capacity);
+    game.SetRetireTime(game_record.retire_time);
+    game.SetMaxSessionDogs(game_record.max_session_dogs);
+    if (game_record.loot_period > 0) {
+        game.SetGenerator(std::make_shared<loot_gen::LootGenerator>(
+            std::chrono::milliseconds(game_record.loot_period), game_record.loot_probability));
+    }
+
+    for (std::size_t i = 0; i < reader.Count(Section::MAPS); ++i) {
+        const auto record = reader.Get<MapRecord>(Section::MAPS, i);
+        CheckRange(reader, Section::ROADS, record.roads);
+        CheckRange(reader, Section::BUILDINGS, record.buildings);
+        CheckRange(reader, Section::OFFICES, record.offices);
+        CheckRange(reader, Section::LOOT_TYPES, record.loot_types);
+
+        model::Map map(model::Map::Id(std::string(reader.GetString(record.id))),
+                       std::string(reader.GetString(record.name)));
+        map.AddSpeed(record.dog_speed);
+        map.AddCapacity(record.bag_capacity);
+
+        for (std::uint32_t r = 0; r < record.roads.count; ++r) {
+            const auto road = reader.Get<RoadRecord>(Section::ROADS, record.roads.begin + r);
+            const model::Point start{road.x0, road.y0};
+            if (road.vertical) {
+                map.AddRoad(model::Road(model::Road::VERTICAL, start, road.end));
+            } else {
+                map.AddRoad(model::Road(model::Road::HORIZONTAL, start, road.end));
+            }
+        }
+
+        for (std::uint32_t b = 0; b < record.buildings.count; ++b) {
+            const auto building = reader.Get<BuildingRecord>(Section::BUILDINGS, record.buildings.begin + b);
+            map.AddBuilding(model::Building(model::Rectangle{{building.x, building.y}, {building.w, building.h}}));
+        }
+
+        for (std::uint32_t o = 0; o < record.offices.count; ++o) {
+            const auto office = reader.Get<OfficeRecord>(Section::OFFICES, record.offices.begin + o);
+            map.AddOffice(model::Office(model::Office::Id(std::string(reader.GetString(office.id))),
+                                        {office.x, office.y}, {office.offset_x, office.offset_y}));
+        }
+
+        model::LootTypes loot_types;
+        loot_types.reserve(record.loot_types.count);
+        for (std::uint32_t t = 0; t < record.loot_types.count; ++t) {
+            const auto type = reader.Get<LootTypeRecord>(Section::LOOT_TYPES, record.loot_types.begin + t);
+            loot_types.push_back(model::LootType{
+                std::string(reader.GetString(type.name)), type.value, std::string(reader.GetString(type.json))});
+        }
+        map.SetLootTypes(std::move(loot_types));
+
+        game.AddMap(std::move(map));
+    }
+
+    return game;
+}
+
+bool IsMapPackFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::array<char, MAGIC.size()> magic{};
+    if (!file.read(magic.data(), magic.size())) {
+        return false;
+    }
+    return MapPack::IsMapPack(std::string_view(magic.data(), magic.size()));
+}
+
+model::Game LoadMapPack(const std::filesystem::path& path) {
+    MappedFile file(path);
+    return MapPack::Decode(file.View());
+}
+
+}  // namespace map_pack
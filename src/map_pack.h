@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#include "model.h"
+
+namespace map_pack {
+
+/*
+ *  Скомпилированный набор карт. Исходным форматом остается config.json,
+ *  а утилита map_compiler заранее переводит его в двоичный файл, который сервер
+ *  при запуске отображает в память и читает без разбора JSON.
+ *
+ *  Устройство файла повторяет файл состояния (state_format.h): заголовок с сигнатурой,
+ *  версией, размером и контрольной суммой, таблица секций и секции из записей
+ *  фиксированного размера - параметры игры, карты, дороги, здания, офисы,
+ *  типы лута и блок строк. Записи дорог уже содержат ориентацию, а типы лута -
+ *  номер, ценность и готовое JSON-описание для /api/v1/maps/{id}.
+ */
+inline constexpr std::uint32_t MAP_PACK_VERSION = 2;
+
+class MapPack {
+public:
+    MapPack() = delete;
+
+    // Кодирует карты и параметры загруженной игры
+    static std::string Encode(const model::Game& game);
+
+    // Восстанавливает игру из данных набора карт.
+    // Выбрасывает std::runtime_error, если данные повреждены
+    static model::Game Decode(std::string_view data);
+
+    // Начинаются ли данные с сигнатуры набора карт
+    static bool IsMapPack(std::string_view data) noexcept;
+};
+
+// Является ли файл набором карт (а не config.json)
+bool IsMapPackFile(const std::filesystem::path& path);
+
+// Отображает файл набора карт в память и восстанавливает из него игру
+model::Game LoadMapPack(const std::filesystem::path& path);
+
+}  // namespace map_pack
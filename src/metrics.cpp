@@ -0,0 +1,232 @@
+#include "metrics.h"
+
+#include <bit>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace metrics {
+
+namespace {
+
+// Границы le (в секундах), в которые сворачиваются корзины гистограмм при выдаче
+constexpr std::array<double, 18> EXPORT_BOUNDS = {
+    0.00005, 0.0001, 0.00025, 0.0005,
+    0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+    0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0
+};
+
+std::string_view TypeName(MetricType type) {
+    switch (type) {
+        case MetricType::COUNTER:
+            return "counter";
+        case MetricType::GAUGE:
+            return "gauge";
+        case MetricType::HISTOGRAM:
+            return "histogram";
+    }
+    return "untyped";
+}
+
+void WriteSample(std::ostream& out, const std::string& name, std::string_view suffix,
+                 const std::string& labels, std::string_view extra_label, double value) {
+    out << name << suffix;
+    if (!labels.empty() || !extra_label.empty()) {
+        out << '{' << labels;
+        if (!labels.empty() && !extra_label.empty()) {
+            out << ',';
+        }
+        out << extra_label << '}';
+    }
+    out << ' ' << value << '\n';
+}
+
+} // namespace
+
+std::size_t ShardIndex() noexcept {
+    static std::atomic<std::size_t> next_index{0};
+    thread_local const std::size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+    return index;
+}
+
+std::uint64_t Counter::Value() const noexcept {
+    std::uint64_t result = 0;
+    for (const auto& shard : shards_) {
+        result += shard.value.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+void Counter::Write(std::ostream& out, const std::string& name, const std::string& labels) const {
+    WriteSample(out, name, "", labels, "", static_cast<double>(Value()));
+}
+
+void Gauge::Write(std::ostream& out, const std::string& name, const std::string& labels) const {
+    WriteSample(out, name, "", labels, "", Value());
+}
+
+void CallbackMetric::Write(std::ostream& out, const std::string& name, const std::string& labels) const {
+    WriteSample(out, name, "", labels, "", callback_());
+}
+
+std::size_t Histogram::BucketIndex(std::uint64_t micros) noexcept {
+    if (micros < SUB_BUCKETS) {
+        return static_cast<std::size_t>(micros);
+    }
+    // номер старшего бита - октава, следующие SUB_BUCKET_BITS бит - подкорзина
+    const int exponent = std::bit_width(micros) - 1;
+    const std::size_t sub_bucket = (micros >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    const std::size_t index = (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub_bucket;
+    return std::min(index, BUCKETS - 1);
+}
+
+std::uint64_t Histogram::BucketUpperBound(std::size_t index) noexcept {
+    if (index < SUB_BUCKETS) {
+        return index + 1;
+    }
+    const std::size_t shift = index / SUB_BUCKETS - 1;
+    const std::uint64_t sub_bucket = index % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub_bucket + 1) << shift;
+}
+
+void Histogram::ObserveNanoseconds(std::int64_t nanoseconds) noexcept {
+    const std::uint64_t value = nanoseconds > 0 ? static_cast<std::uint64_t>(nanoseconds) : 0;
+    auto& shard = shards_[ShardIndex()];
+    shard.buckets[BucketIndex(value / 1000)].fetch_add(1, std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+    shard.sum_ns.fetch_add(value, std::memory_order_relaxed);
+}
+
+std::uint64_t Histogram::Count() const noexcept {
+    std::uint64_t result = 0;
+    for (const auto& shard : shards_) {
+        result += shard.count.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+std::chrono::nanoseconds Histogram::Sum() const noexcept {
+    std::uint64_t result = 0;
+    for (const auto& shard : shards_) {
+        result += shard.sum_ns.load(std::memory_order_relaxed);
+    }
+    return std::chrono::nanoseconds(result);
+}
+
+void Histogram::Write(std::ostream& out, const std::string& name, const std::string& labels) const {
+    std::array<std::uint64_t, BUCKETS> buckets{};
+    std::uint64_t count = 0;
+    std::uint64_t sum_ns = 0;
+
+    for (const auto& shard : shards_) {
+        for (std::size_t i = 0; i < BUCKETS; ++i) {
+            buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+        count += shard.count.load(std::memory_order_relaxed);
+        sum_ns += shard.sum_ns.load(std::memory_order_relaxed);
+    }
+
+    // корзина попадает под границу le, если вся она лежит не выше этой границы
+    std::size_t bucket = 0;
+    std::uint64_t cumulative = 0;
+    for (double bound : EXPORT_BOUNDS) {
+        const auto bound_micros = static_cast<std::uint64_t>(bound * 1e6);
+        while (bucket < BUCKETS && BucketUpperBound(bucket) <= bound_micros) {
+            cumulative += buckets[bucket++];
+        }
+        std::ostringstream le;
+        le << "le=\"" << bound << '"';
+        WriteSample(out, name, "_bucket", labels, le.str(), static_cast<double>(cumulative));
+    }
+
+    WriteSample(out, name, "_bucket", labels, "le=\"+Inf\"", static_cast<double>(count));
+    WriteSample(out, name, "_sum", labels, "", static_cast<double>(sum_ns) / 1e9);
+    WriteSample(out, name, "_count", labels, "", static_cast<double>(count));
+}
+
+std::string Labels(std::initializer_list<std::pair<std::string_view, std::string_view>> labels) {
+    std::string result;
+    for (const auto& [key, value] : labels) {
+        if (!result.empty()) {
+            result += ',';
+        }
+        result += key;
+        result += "=\"";
+        for (char c : value) {
+            if (c == '\\' || c == '"') {
+                result += '\\';
+                result += c;
+            } else if (c == '\n') {
+                result += "\\n";
+            } else {
+                result += c;
+            }
+        }
+        result += '"';
+    }
+    return result;
+}
+
+Registry& Registry::Instance() {
+    static Registry registry;
+    return registry;
+}
+
+template <typename T, typename... Args>
+T& Registry::GetOrCreate(const std::string& name, std::string_view help, MetricType type,
+                         const std::string& labels, Args&&... args) {
+    std::lock_guard lock{mutex_};
+
+    auto [family_it, inserted] = families_.try_emplace(name, Family{std::string(help), type, {}});
+    auto& family = family_it->second;
+
+    if (family.type != type) {
+        throw std::logic_error("Metric " + name + " is registered with another type");
+    }
+
+    auto& metric = family.metrics[labels];
+    if (!metric) {
+        metric = std::make_unique<T>(std::forward<Args>(args)...);
+    }
+
+    auto* result = dynamic_cast<T*>(metric.get());
+    if (!result) {
+        throw std::logic_error("Metric " + name + " is registered with another type");
+    }
+    return *result;
+}
+
+Counter& Registry::GetCounter(const std::string& name, std::string_view help, const std::string& labels) {
+    return GetOrCreate<Counter>(name, help, MetricType::COUNTER, labels);
+}
+
+Gauge& Registry::GetGauge(const std::string& name, std::string_view help, const std::string& labels) {
+    return GetOrCreate<Gauge>(name, help, MetricType::GAUGE, labels);
+}
+
+Histogram& Registry::GetHistogram(const std::string& name, std::string_view help, const std::string& labels) {
+    return GetOrCreate<Histogram>(name, help, MetricType::HISTOGRAM, labels);
+}
+
+void Registry::AddCallback(const std::string& name, std::string_view help, MetricType type,
+                           std::function<double()> callback, const std::string& labels) {
+    GetOrCreate<CallbackMetric>(name, help, type, labels, std::move(callback));
+}
+
+std::string Registry::Serialize() const {
+    std::ostringstream out;
+    out << std::setprecision(10);
+
+    std::lock_guard lock{mutex_};
+    for (const auto& [name, family] : families_) {
+        out << "# HELP " << name << ' ' << family.help << '\n';
+        out << "# TYPE " << name << ' ' << TypeName(family.type) << '\n';
+        for (const auto& [labels, metric] : family.metrics) {
+            metric->Write(out, name, labels);
+        }
+    }
+
+    return out.str();
+}
+
+}  // namespace metrics
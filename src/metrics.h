@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace metrics {
+
+using Clock = std::chrono::steady_clock;
+
+// Число независимых ячеек у счетчиков и гистограмм. Каждый поток пишет в свою ячейку,
+// поэтому запись - это одна атомарная операция без конкуренции за кэш-линию
+inline constexpr std::size_t SHARDS = 8;
+
+// Номер ячейки текущего потока
+std::size_t ShardIndex() noexcept;
+
+enum class MetricType {
+    COUNTER,
+    GAUGE,
+    HISTOGRAM
+};
+
+class Metric {
+public:
+    virtual ~Metric() = default;
+    virtual void Write(std::ostream& out, const std::string& name, const std::string& labels) const = 0;
+};
+
+class Counter : public Metric {
+public:
+    void Add(std::uint64_t value = 1) noexcept {
+        shards_[ShardIndex()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    std::uint64_t Value() const noexcept;
+
+    void Write(std::ostream& out, const std::string& name, const std::string& labels) const override;
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    std::array<Cell, SHARDS> shards_;
+};
+
+class Gauge : public Metric {
+public:
+    void Set(double value) noexcept {
+        value_.store(value, std::memory_order_relaxed);
+    }
+
+    double Value() const noexcept {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+    void Write(std::ostream& out, const std::string& name, const std::string& labels) const override;
+
+private:
+    std::atomic<double> value_{0};
+};
+
+// Значение вычисляется в момент выдачи метрик
+class CallbackMetric : public Metric {
+public:
+    explicit CallbackMetric(std::function<double()> callback)
+        : callback_(std::move(callback)) {
+    }
+
+    void Write(std::ostream& out, const std::string& name, const std::string& labels) const override;
+
+private:
+    std::function<double()> callback_;
+};
+
+/*
+ *  Гистограмма длительностей в стиле HDR: значения в микросекундах раскладываются
+ *  по логарифмическим корзинам, каждая октава делится на 4 линейные подкорзины
+ *  (относительная погрешность не больше 25%). При выдаче корзины сворачиваются
+ *  в фиксированный набор границ le в секундах.
+ */
+class Histogram : public Metric {
+public:
+    static constexpr int SUB_BUCKET_BITS = 2;
+    static constexpr std::size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr std::size_t BUCKETS = 40 * SUB_BUCKETS;
+
+    template <typename Rep, typename Period>
+    void Observe(std::chrono::duration<Rep, Period> value) noexcept {
+        ObserveNanoseconds(std::chrono::duration_cast<std::chrono::nanoseconds>(value).count());
+    }
+
+    void ObserveNanoseconds(std::int64_t nanoseconds) noexcept;
+
+    static std::size_t BucketIndex(std::uint64_t micros) noexcept;
+
+    // Верхняя (не включаемая) граница корзины в микросекундах
+    static std::uint64_t BucketUpperBound(std::size_t index) noexcept;
+
+    std::uint64_t Count() const noexcept;
+
+    // Сумма всех наблюдений
+    std::chrono::nanoseconds Sum() const noexcept;
+
+    void Write(std::ostream& out, const std::string& name, const std::string& labels) const override;
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<std::uint64_t>, BUCKETS> buckets{};
+        std::atomic<std::uint64_t> count{0};
+        std::atomic<std::uint64_t> sum_ns{0};
+    };
+
+    std::array<Shard, SHARDS> shards_;
+};
+
+// Замеряет время между вызовами Lap
+class Stopwatch {
+public:
+    Stopwatch() : start_(Clock::now()) {}
+
+    Clock::duration Lap() noexcept {
+        auto now = Clock::now();
+        auto elapsed = now - start_;
+        start_ = now;
+        return elapsed;
+    }
+
+    void Lap(Histogram& histogram) noexcept {
+        histogram.Observe(Lap());
+    }
+
+private:
+    Clock::time_point start_;
+};
+
+// Записывает время жизни объекта в гистограмму
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram) : histogram_(histogram) {}
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    ~ScopedTimer() {
+        stopwatch_.Lap(histogram_);
+    }
+
+private:
+    Histogram& histogram_;
+    Stopwatch stopwatch_;
+};
+
+// Собирает строку меток вида key1="value1",key2="value2"
+std::string Labels(std::initializer_list<std::pair<std::string_view, std::string_view>> labels);
+
+/*
+ *  Реестр метрик. Метрики создаются один раз под мьютексом и дальше живут до конца
+ *  работы программы, поэтому на горячем пути достаточно сохранить ссылку на метрику.
+ */
+class Registry {
+public:
+    static Registry& Instance();
+
+    Counter& GetCounter(const std::string& name, std::string_view help, const std::string& labels = {});
+    Gauge& GetGauge(const std::string& name, std::string_view help, const std::string& labels = {});
+    Histogram& GetHistogram(const std::string& name, std::string_view help, const std::string& labels = {});
+
+    void AddCallback(const std::string& name, std::string_view help, MetricType type,
+                     std::function<double()> callback, const std::string& labels = {});
+
+    // Выдача всех метрик в текстовом формате Prometheus
+    std::string Serialize() const;
+
+private:
+    Registry() = default;
+
+    struct Family {
+        std::string help;
+        MetricType type;
+        std::map<std::string, std::unique_ptr<Metric>> metrics;
+    };
+
+    template <typename T, typename... Args>
+    T& GetOrCreate(const std::string& name, std::string_view help, MetricType type,
+                   const std::string& labels, Args&&... args);
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+};
+
+// Значение ранга rank (0..1) в отсортированной выборке, 0 для пустой.
+// Для отчетов инструментов и прогонов, где гистограмма не нужна
+inline double Percentile(const std::vector<double>& sorted, double rank) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    const auto index = static_cast<std::size_t>(rank * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+}  // namespace metrics
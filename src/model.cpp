@@ -1,18 +1,107 @@
 #include "model.h"
 #include "application.h"
 #include <stdexcept>
+#include <unordered_set>
 
 #include "collision_detector.h"
 #include "model_serialization.h"
+#include "state_saver.h"
+#include "state_format.h"
+#include "journal.h"
+#include "recording.h"
+#include "metrics.h"
+#include "trace.h"
+#include "alloc_counter.h"
 
 namespace model {
 using namespace std::literals;
 
+namespace {
+
+enum class TickPhase {
+    MOVEMENT,
+    GATHERING,
+    LOOT_SPAWN,
+    RETIREMENT,
+    SNAPSHOT
+};
+
+// Имена фаз в метках game_tick_phase_duration_seconds и в трассе
+constexpr std::array<std::string_view, 5> TICK_PHASE_NAMES = {
+    "movement",
+    "gathering",
+    "loot_spawn",
+    "retirement",
+    "snapshot"
+};
+
+// Гистограмма длительности фазы тика сессии
+metrics::Histogram& TickPhaseDuration(TickPhase phase) {
+    static const auto histograms = [] {
+        std::array<metrics::Histogram*, TICK_PHASE_NAMES.size()> result;
+        for (std::size_t i = 0; i < TICK_PHASE_NAMES.size(); ++i) {
+            result[i] = &metrics::Registry::Instance().GetHistogram(
+                "game_tick_phase_duration_seconds",
+                "Duration of a game session tick phase",
+                metrics::Labels({{"phase", TICK_PHASE_NAMES[i]}}));
+        }
+        return result;
+    }();
+    return *histograms[static_cast<std::size_t>(phase)];
+}
+
+// Счетчики выделений памяти в фазе тика (сборка с GAME_COUNT_ALLOCATIONS)
+struct PhaseAllocations {
+    metrics::Counter* allocations;
+    metrics::Counter* bytes;
+};
+
+PhaseAllocations TickPhaseAllocations(TickPhase phase) {
+    static const auto counters = [] {
+        std::array<PhaseAllocations, TICK_PHASE_NAMES.size()> result;
+        for (std::size_t i = 0; i < TICK_PHASE_NAMES.size(); ++i) {
+            const auto labels = metrics::Labels({{"phase", TICK_PHASE_NAMES[i]}});
+            result[i].allocations = &metrics::Registry::Instance().GetCounter(
+                "game_tick_phase_allocations_total", "Heap allocations made in a game session tick phase", labels);
+            result[i].bytes = &metrics::Registry::Instance().GetCounter(
+                "game_tick_phase_allocated_bytes_total", "Bytes allocated on the heap in a game session tick phase", labels);
+        }
+        return result;
+    }();
+    return counters[static_cast<std::size_t>(phase)];
+}
+
+// Замеряет фазы тика сессии: каждая фаза длится от конца предыдущей
+class TickPhases {
+public:
+    void End(TickPhase phase) {
+        const auto elapsed = stopwatch_.Lap();
+        TickPhaseDuration(phase).Observe(elapsed);
+        TRACE_COMPLETE(TICK_PHASE_NAMES[static_cast<std::size_t>(phase)], metrics::Clock::now() - elapsed, elapsed);
+        
+        if constexpr (alloc_counter::ENABLED) {
+            const auto now = alloc_counter::ThreadCounts();
+            const auto delta = now - allocations_;
+            const auto counters = TickPhaseAllocations(phase);
+            counters.allocations->Add(delta.allocations);
+            counters.bytes->Add(delta.bytes);
+            allocations_ = now;
+        }
+    }
+    
+private:
+    metrics::Stopwatch stopwatch_;
+    alloc_counter::Counts allocations_ = alloc_counter::ThreadCounts();
+};
+
+} // namespace
+
 std::atomic<int> Loot::counter_{0};
 std::atomic<int> Dog::counter_{0};
 std::atomic<int> GameSession::counter_{0};
+std::atomic<std::uint64_t> MapCatalog::next_generation_{1};
 
-Coords Road::GetRandomCords(double len) {
+Coords Road::GetRandomCords(double len) const {
     
     len = std::min(len, GetLen());
     
@@ -29,7 +118,7 @@ Coords Road::GetRandomCords(double len) {
     return Coords{static_cast<double>(start_.x), end_.y + len};
 }
 
-bool Road::PointIsInside(Coords point) {
+bool Road::PointIsInside(Coords point) const {
     if (IsHorizontal()) {
         
         double up = start_.y - ROAD_BOUNDARY_OFFSET;
@@ -50,7 +139,7 @@ bool Road::PointIsInside(Coords point) {
     return point.x <= right && point.x >= left && point.y >= up && point.y <= down;
 }
 
-Coords Road::GetLastPointOnRoad(Coords start, Coords end) {
+Coords Road::GetLastPointOnRoad(Coords start, Coords end) const {
     if (start == end) return end;
     
     double up;
@@ -89,16 +178,20 @@ Coords Road::GetLastPointOnRoad(Coords start, Coords end) {
     return {std::max(left, end.x), start.y};
 }
 
-Coords Map::GetRandomCordsOnMap() {
+Coords Map::GetRandomCordsOnMap() const {
+    // устройство случайных чисел открывается один раз на поток, а не на каждый вызов
+    thread_local std::mt19937_64 gen{std::random_device{}()};
+    return GetRandomCordsOnMap(gen);
+}
+
+Coords Map::GetRandomCordsOnMap(std::mt19937_64& gen) const {
     int num = static_cast<int>(roads_.size());
     
-    std::random_device rd; // Для получения настоящего случайного числа из устройства
-    std::mt19937 gen(rd()); // Стандартный механизм генерации случайных чисел
     std::uniform_int_distribution<> distrib_1(0, num - 1); // Определяем диапазон
 
     int i = distrib_1(gen);
     
-    auto road = roads_[i];
+    const auto& road = roads_[i];
     double len = road.GetLen();
     
     std::uniform_real_distribution<> distrib_2(0.0, len);
@@ -108,7 +201,7 @@ Coords Map::GetRandomCordsOnMap() {
     return road.GetRandomCords(j);
 }
 
-Coords Map::GetFirstCordsOnMap() {
+Coords Map::GetFirstCordsOnMap() const {
     auto road = roads_[0];
     Point start = road.GetStart();
     return {static_cast<double>(start.x), static_cast<double>(start.y)};
@@ -155,12 +248,12 @@ Coords Dog::GetNewCords(int tick) {
     return {cords_.x + speed_.x * tick_double, cords_.y + speed_.y * tick_double};
 }
 
-Coords Dog::FindRouteRec(Coords start, Coords end, Roads& roads) {
+Coords Dog::FindRouteRec(Coords start, Coords end, std::span<const Road* const> roads,
+                         std::pmr::memory_resource* scratch) {
     Coords last_point_on_this_road = start; // Инициализируем, чтобы вернуть start, если ничего не найдено
-    bool found_route = false;
 
     for (size_t i = 0; i < roads.size(); ++i) {
-        auto& road = roads[i]; // Получаем ссылку на текущую дорогу
+        const Road& road = *roads[i]; // Получаем ссылку на текущую дорогу
 
         if (road.PointIsInside(start)) {
             last_point_on_this_road = road.GetLastPointOnRoad(start, end);
@@ -169,8 +262,9 @@ Coords Dog::FindRouteRec(Coords start, Coords end, Roads& roads) {
                 return end; // Базовый случай: нашли конечную точку
             }
 
-            // Создаем новый вектор roads, исключая текущую дорогу
-            Roads next_roads;
+            // Создаем новый список дорог, исключая текущую (указатели, во временной памяти тика)
+            std::pmr::vector<const Road*> next_roads(scratch);
+            next_roads.reserve(roads.size() - 1);
             for (size_t j = 0; j < roads.size(); ++j) {
                 if (i != j) {
                     next_roads.push_back(roads[j]);
@@ -178,7 +272,7 @@ Coords Dog::FindRouteRec(Coords start, Coords end, Roads& roads) {
             }
 
             // Рекурсивный вызов с уменьшенным набором дорог
-            Coords recursive_result = FindRouteRec(last_point_on_this_road, end, next_roads);
+            Coords recursive_result = FindRouteRec(last_point_on_this_road, end, next_roads, scratch);
 
             if (recursive_result != start) {
                 // Если рекурсивный вызов нашел путь
@@ -192,7 +286,7 @@ Coords Dog::FindRouteRec(Coords start, Coords end, Roads& roads) {
     return start;
 }
 
-void Dog::UpdateTickState(int tick, MapShared map) {
+void Dog::UpdateTickState(int tick, const MapShared& map, std::pmr::memory_resource* scratch) {
     
     full_time_ += tick;
     
@@ -206,15 +300,20 @@ void Dog::UpdateTickState(int tick, MapShared map) {
     Coords new_cords = GetNewCords(tick);
     
     // если начальные и конечные точки внутри одной дороги - можно двигаться до конечной
-    auto roads = map->GetRoads();
-    for (auto road : roads) {
+    const auto& roads = map->GetRoads();
+    for (const auto& road : roads) {
         if (road.PointIsInside(cords_) && road.PointIsInside(new_cords)) {
             cords_ = new_cords;
             return;
         }
     }
 
-    cords_ = FindRouteRec(cords_, new_cords, roads);
+    std::pmr::vector<const Road*> all_roads(scratch);
+    all_roads.reserve(roads.size());
+    for (const auto& road : roads) {
+        all_roads.push_back(&road);
+    }
+    cords_ = FindRouteRec(cords_, new_cords, all_roads, scratch);
     
     if (cords_ != new_cords) {
         speed_ = {0, 0};
@@ -223,20 +322,20 @@ void Dog::UpdateTickState(int tick, MapShared map) {
 
 void Dog::UnloadBag(MapShared map) {
     
-    for (auto loot : bag_) {
+    for (const auto& loot : bag_) {
         score_ += map->GetValueOfLoot(loot.GetType());
     }
     
-    bag_.clear();
+    bag_.Clear();
 }
 
-void Game::AddMap(Map map) {
+void MapCatalog::AddMap(Map map) {
     const size_t index = maps_.size();
     if (auto [it, inserted] = map_id_to_index_.emplace(map.GetId(), index); !inserted) {
         throw std::invalid_argument("Map with id "s + *map.GetId() + " already exists"s);
     } else {
         try {
-            maps_.emplace_back(std::move(map));
+            maps_.push_back(std::make_shared<const Map>(std::move(map)));
         } catch (const std::exception& e) {
             map_id_to_index_.erase(it);
             throw;
@@ -244,83 +343,176 @@ void Game::AddMap(Map map) {
     }
 }
 
-GameSessionShared Game::AddDogToSession(DogShared dog, const std::string map) {
+void Game::AddMap(Map map) {
+    // карты добавляются только при загрузке конфигурации, пока набор не опубликован
+    std::const_pointer_cast<MapCatalog>(maps_)->AddMap(std::move(map));
+}
+
+void Game::ReplaceMaps(MapCatalogShared maps, double default_dog_speed, int default_bag_capacity) {
+    maps_ = std::move(maps);
+    default_dog_speed_ = default_dog_speed;
+    default_bag_capacity_ = default_bag_capacity;
+    // сессии прежнего набора доигрывают без новых собак
+    sessions_by_map_.clear();
+}
+
+void Game::AddSession(GameSessionShared session) {
+    sessions_by_map_[session->GetMapId()].push_back(session);
+    sessions_.push_back(std::move(session));
+}
+
+DogRef Game::AddDogToSession(Dog dog, const std::string& map) {
     
     auto map_id = Map::Id(map);
     
     // проверка, есть ли вообще нужная карта
-    if (!map_id_to_index_.count(map_id)) {
-        return nullptr;
+    MapShared map_found = maps_->FindMap(map_id);
+    if (!map_found) {
+        return {};
     }
     
-    auto map_in_which_add = maps_[map_id_to_index_[map_id]];
+    const Map& map_in_which_add = *map_found;
     
     // добавление скорости
     if (map_in_which_add.GetSpeed() != 1) {
-        dog->SetMapSpeed(map_in_which_add.GetSpeed());
+        dog.SetMapSpeed(map_in_which_add.GetSpeed());
     } else if (default_dog_speed_ != 1) {
-        dog->SetMapSpeed(default_dog_speed_);
+        dog.SetMapSpeed(default_dog_speed_);
     }
     
     // добавление вместимости
     if (map_in_which_add.GetCapacity() != 3) {
-        dog->SetBagCapacity(map_in_which_add.GetCapacity());
+        dog.SetBagCapacity(map_in_which_add.GetCapacity());
     } else if (default_bag_capacity_ != 3) {
-        dog->SetBagCapacity(default_bag_capacity_);
+        dog.SetBagCapacity(default_bag_capacity_);
     }
     
     // добавление координат
     if (randomize_spawn_point_) {
-        dog->SetCords(map_in_which_add.GetRandomCordsOnMap());
+        dog.SetCords(map_in_which_add.GetRandomCordsOnMap());
     } else {
-        dog->SetCords(map_in_which_add.GetFirstCordsOnMap());
+        dog.SetCords(map_in_which_add.GetFirstCordsOnMap());
     }
     
-    // проверка, есть ли сессия с нужной картой
-    auto it = std::find_if(sessions_.begin(), sessions_.end(),
-                          [map_id](GameSessionShared session) {
-        return session->GetMapId() == map_id;
+    // наименее загруженная сессия карты из текущего набора, в которой еще есть место
+    const auto generation = maps_->GetGeneration();
+    auto& map_sessions = sessions_by_map_[map_id];
+    std::erase_if(map_sessions, [generation](const GameSessionShared& session) {
+        return session->GetMapsGeneration() != generation;
     });
     
-    // если сессия уже есть
-    if (it != sessions_.end()) {
-        (*it)->AddDog(dog);
-        return *it;
+    const GameSessionShared* target = nullptr;
+    for (const auto& session : map_sessions) {
+        const std::size_t dogs = session->GetDogs().Size();
+        if (max_session_dogs_ > 0 && dogs >= static_cast<std::size_t>(max_session_dogs_)) {
+            continue;
+        }
+        if (!target || dogs < (*target)->GetDogs().Size()) {
+            target = &session;
+        }
+    }
+    
+    // все сессии карты заполнены или их еще нет
+    if (!target) {
+        GameSessionShared new_session(new GameSession(map_found));
+        new_session->SetMapsGeneration(generation);
+        AddSession(std::move(new_session));
+        target = &sessions_by_map_[map_id].back();
     }
     
-    GameSessionShared new_session(new GameSession(
-                                                  std::make_shared<Map>(maps_[map_id_to_index_[map_id]])
-                                                  ));
+    const auto& session = *target;
+    const auto handle = session->AddDog(std::move(dog));
+    session->PublishSnapshot();
+    
+    return {session, handle};
+}
+
+void GameSession::PublishSnapshot() {
+    // Прежний снимок больше не опубликован, поэтому новых читателей у него не появится.
+    // Если отпустили и старых, его строки и векторы заполняются заново без выделения памяти
+    std::shared_ptr<SessionSnapshot> snapshot = std::move(spare_snapshot_);
+    if (snapshot && snapshot.use_count() == 1) {
+        // видеть все, что читатели сделали со снимком до того, как его отпустить
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } else {
+        snapshot = std::make_shared<SessionSnapshot>();
+    }
+    
+    snapshot->version = ++snapshot_version_;
+    snapshot->loots.reserve(loots_.capacity());
+    snapshot->loots = loots_;
+    snapshot->dogs.resize(dogs_.Size());
+    
+    for (std::size_t i = 0; i < dogs_.Size(); ++i) {
+        const auto& dog = dogs_[i];
+        auto& dog_snapshot = snapshot->dogs[i];
+        dog_snapshot.id = dog.GetId();
+        dog_snapshot.name = dog.GetName();
+        dog_snapshot.cords = dog.GetCords();
+        dog_snapshot.speed = dog.GetSpeed();
+        dog_snapshot.direction = dog.GetDirection();
+        dog_snapshot.bag = dog.GetBag();
+        dog_snapshot.score = dog.GetScore();
+    }
+    
+    auto previous = std::atomic_exchange_explicit(&snapshot_, SessionSnapshotShared(std::move(snapshot)),
+                                                  std::memory_order_acq_rel);
+    // снимки создаются изменяемыми, константность только у читателей
+    spare_snapshot_ = std::const_pointer_cast<SessionSnapshot>(std::move(previous));
+}
+
+void GameSession::ApplyActions(journal::EventSink* events, std::pmr::memory_resource* scratch) {
+    if (actions_.Empty()) {
+        return;
+    }
     
-    new_session->AddDog(dog);
-    sessions_.push_back(new_session);
+    std::pmr::vector<PlayerAction> actions(scratch);
+    actions_.Drain([&actions](PlayerAction&& action) {
+        actions.push_back(std::move(action));
+    });
     
-    return sessions_.back();
+    std::pmr::unordered_set<int> applied(actions.size(), scratch);
+    for (auto it = actions.rbegin(); it != actions.rend(); ++it) {
+        // собака могла уйти на покой после того, как команда попала в очередь
+        Dog* dog = dogs_.Get(it->dog);
+        if (dog && applied.insert(dog->GetId()).second) {
+            dog->SetDirection(it->move);
+            if (events) {
+                events->Append(journal::MoveEvent{dog->GetId(), it->move});
+            }
+        }
+    }
 }
 
-void GameSession::UpdateTickState(int tick, LootGeneratorShared loot_generator, PoolShared pool, int retire_trashhold) {
+void GameSession::UpdateTickState(int tick, LootGeneratorShared loot_generator, postgres::RecordStore* records, int retire_trashhold,
+                                  std::mt19937_64& random, journal::EventSink* events, std::pmr::memory_resource* scratch) {
     using namespace collision_detector;
     
-    ItemGatherer item_gatherer;
+    TRACE_SPAN("session.tick");
+    TickPhases phases;
+    
+    ApplyActions(events, scratch);
     
-    std::vector<DogShared> dogs_in_concrete_order;
+    ItemGatherer item_gatherer(scratch);
+    item_gatherer.Reserve(loots_.size() + map_->GetOffices().size(), dogs_.Size());
     
-    for (auto dog : dogs_) {
+    // собирателем i в item_gatherer будет собака dogs_[i]
+    for (auto& dog : dogs_) {
         
-        Coords previous_coords = dog->GetCords();
-        dog->UpdateTickState(tick, map_);
-        Coords actual_coords = dog->GetCords();
+        Coords previous_coords = dog.GetCords();
+        dog.UpdateTickState(tick, map_, scratch);
+        Coords actual_coords = dog.GetCords();
         
         item_gatherer.AddGatherer(Gatherer{
             {actual_coords.x, actual_coords.y},
             {previous_coords.x, previous_coords.y},
             DOG_WIDTH
         });
-        
-        dogs_in_concrete_order.push_back(dog);
     }
     
-    for (auto loot : loots_) {
+    phases.End(TickPhase::MOVEMENT);
+    
+    for (const auto& loot : loots_) {
         item_gatherer.AddItem(Item{
             {loot.GetPosition().x, loot.GetPosition().y},
             LOOT_WIDTH
@@ -334,163 +526,356 @@ void GameSession::UpdateTickState(int tick, LootGeneratorShared loot_generator,
         });
     }
     
-    auto gathering_events = FindGatherEvents(item_gatherer);
+    auto gathering_events = FindGatherEvents(item_gatherer, scratch);
     
     for (auto& event : gathering_events) {
         
-        auto dog = dogs_in_concrete_order[event.gatherer_id];
+        auto& dog = dogs_[event.gatherer_id];
 
         // собака подобрала предмет
-        if (event.item_id < loots_.size() && !dog->BagIsFull()) {
+        if (event.item_id < loots_.size() && !dog.BagIsFull()) {
             
-            dog->TakeLoot(loots_[event.item_id]);
+            dog.TakeLoot(loots_[event.item_id]);
             loots_.erase(loots_.begin() + event.item_id);
             
         } else {
-            dog->UnloadBag(map_);
+            dog.UnloadBag(map_);
         }
     }
     
+    phases.End(TickPhase::GATHERING);
+    
     // количество новых предметов
     auto number_of_loots = loot_generator->Generate(
         std::chrono::milliseconds(tick),
         static_cast<unsigned>(loots_.size()),
-        static_cast<unsigned>(dogs_.size())
+        static_cast<unsigned>(dogs_.Size())
     );
     
     // генератор
-    std::random_device rd;
-    std::mt19937 gen(rd());
     std::uniform_int_distribution<int> distrib(0, map_->GetNumberOfLootOptions() - 1);
     
     // генерирование новых предметов
     while (number_of_loots > 0) {
-        loots_.emplace_back(distrib(gen), map_->GetRandomCordsOnMap());
+        loots_.emplace_back(distrib(random), map_->GetRandomCordsOnMap(random));
         // увеличивается счетчик всех предметов, которые были/есть на карте
         --number_of_loots;
     }
     
-    // отправка собачек на покой
-    for (auto it = dogs_.begin(); it != dogs_.end();) {
-        auto dog = *it;
+    phases.End(TickPhase::LOOT_SPAWN);
+    
+    // отправка собачек на покой: все ушедшие удаляются из пула за один проход
+    dogs_.EraseIf([&](const Dog& dog) {
+        if (!dog.IsGoingToRetire(retire_trashhold)) {
+            return false;
+        }
         
-        if (dog->IsGoingToRetire(retire_trashhold)) {
-            
-            postgres::DB::SaveRecord(pool, {
-                dog->GetName(),
-                dog->GetScore(),
-                dog->GetFullTime(),
+        // при восстановлении из журнала хранилища нет: рекорд уже был сохранен
+        if (records) {
+            records->SaveRecord({
+                dog.GetName(),
+                dog.GetScore(),
+                dog.GetFullTime(),
             });
-            
-            Players::RemovePlayerByDogId(dog->GetId());
-            
-            it = dogs_.erase(it);
-        } else {
-            ++it;
         }
-    }
+        
+        if (events) {
+            events->Append(journal::RetireEvent{dog.GetId()});
+        }
+        
+        Players::RemovePlayerByDogId(dog.GetId());
+        return true;
+    });
+    
+    phases.End(TickPhase::RETIREMENT);
+    
+    PublishSnapshot();
+    
+    phases.End(TickPhase::SNAPSHOT);
     
 } // UpdateTickState
 
-void Game::SaveState() {
-    namespace fs = std::filesystem;
-    
-    if (save_file_.empty()) {
-        return;
+void Game::UpdateTickState(int tick) {
+    UpdateTickState(tick, seed_generator_());
+}
+
+void Game::UpdateTickState(int tick, std::uint64_t seed) {
+    static auto& tick_duration = metrics::Registry::Instance().GetHistogram(
+        "game_tick_duration_seconds", "Duration of Game::UpdateTickState");
+    static auto& sessions_gauge = metrics::Registry::Instance().GetGauge(
+        "game_sessions", "Number of game sessions");
+    static auto& dogs_gauge = metrics::Registry::Instance().GetGauge(
+        "game_dogs", "Number of dogs in all sessions");
+    static auto& loots_gauge = metrics::Registry::Instance().GetGauge(
+        "game_loots", "Number of loot items lying on all maps");
+    
+    {
+        TRACE_SPAN("game.tick");
+        metrics::ScopedTimer timer{tick_duration};
+        
+        // временные объекты прошлого тика больше не нужны
+        tick_arena_->Reset();
+        
+        std::mt19937_64 random(seed);
+        for (const auto& session : sessions_) {
+            session->UpdateTickState(tick, loot_generator_, record_store_.get(), retire_time_, random, GetEventSink(),
+                                     tick_arena_->Resource());
+        }
+        
+        // сессии на картах прежнего набора удаляются, когда в них не остается собак
+        const auto generation = maps_->GetGeneration();
+        std::erase_if(sessions_, [generation](const GameSessionShared& session) {
+            return session->GetMapsGeneration() != generation && session->GetDogs().Empty();
+        });
     }
     
-    // код, который отвечает за открытие файла
-    using OutputArchive = boost::archive::text_oarchive;
+    // тик записывается после команд, примененных в его начале
+    if (auto* events = GetEventSink()) {
+        events->Append(journal::TickEvent{tick, seed});
+    }
     
-    fs::path temp_path(save_file_);
-    temp_path += ".tmp";
+    std::size_t dogs = 0;
+    std::size_t loots = 0;
+    for (const auto& session : sessions_) {
+        dogs += session->GetDogs().Size();
+        loots += session->GetLoots().size();
+    }
+    sessions_gauge.Set(static_cast<double>(sessions_.size()));
+    dogs_gauge.Set(static_cast<double>(dogs));
+    loots_gauge.Set(static_cast<double>(loots));
     
-    std::ofstream ofs(temp_path);
+    if (need_to_save_manually) {
+        SaveStateAsync();
+    }
+}
+
+void Game::SetSaveFile(std::string file) {
+    save_file_ = std::move(file);
+    state_saver_ = save_file_.empty() ? nullptr : std::make_shared<serialization::StateSaver>(save_file_);
+}
+
+void Game::StartRecording(const std::string& path, std::string_view config) {
+    StopRecording();
+    recorder_ = std::make_shared<recording::Recorder>(
+        path, config, serialization::BinaryStateFormat::Encode(CaptureState()));
+    events_.Add(recorder_.get());
+}
+
+void Game::StopRecording() {
+    if (!recorder_) {
+        return;
+    }
+    events_.Remove(recorder_.get());
+    recorder_->Finish(recording::StateHash(*this));
+    recorder_.reset();
+}
+
+Game::DogsById Game::IndexDogs() const {
+    DogsById dogs;
+    for (const auto& session : sessions_) {
+        const auto& session_dogs = session->GetDogs();
+        for (std::size_t i = 0; i < session_dogs.Size(); ++i) {
+            dogs.emplace(session_dogs[i].GetId(), DogRef{session, session_dogs.HandleAt(i)});
+        }
+    }
+    return dogs;
+}
+
+void Game::ReplayEvent(const journal::Event& event, DogsById& dogs) {
+    if (const auto* join = std::get_if<journal::JoinEvent>(&event)) {
+        Dog::ReserveId(join->dog_id);
+        auto dog = AddDogToSession(Dog(join->dog_id, join->name), join->map_id);
+        if (!dog.session) {
+            return;
+        }
+        dog.Get()->SetCords({join->x, join->y});
+        Players::AddPlayer(std::make_shared<Player>(join->player_id, join->token, dog.handle, join->dog_id, dog.session));
+        Player::ReserveId(join->player_id);
+        dogs[join->dog_id] = std::move(dog);
+    } else if (const auto* move = std::get_if<journal::MoveEvent>(&event)) {
+        if (auto it = dogs.find(move->dog_id); it != dogs.end()) {
+            // собака, ушедшая на покой, команд уже не получает
+            if (Dog* dog = it->second.Get()) {
+                dog->SetDirection(move->direction);
+            }
+        }
+    } else if (const auto* tick = std::get_if<journal::TickEvent>(&event)) {
+        UpdateTickState(tick->delta, tick->seed);
+    }
+    // уход на покой - следствие тика, он повторяется вместе с ним
+}
+
+void Game::EnableJournal(const journal::Settings& settings) {
+    auto dogs = IndexDogs();
     
-    if (!ofs) throw std::runtime_error("Cannot open file for saving state");
-    OutputArchive oa(ofs);
+    // Повторяем события после контрольной точки. Журнал еще не открыт,
+    // поэтому повторно они в него не пишутся, а сохранения на время повтора отключены
+    const bool need_to_save = std::exchange(need_to_save_manually, false);
+    const std::uint64_t last_segment = journal::Journal::Replay(settings.path, journal_segment_,
+                                                                [this, &dogs](const journal::Event& event) {
+        ReplayEvent(event, dogs);
+    });
+    need_to_save_manually = need_to_save;
+    
+    // дописывать в сегмент, который мог оборваться на поврежденной записи, нельзя
+    journal_segment_ = last_segment + 1;
+    journal_ = std::make_shared<journal::Journal>(settings, journal_segment_);
+    events_.Add(journal_.get());
+    
+    if (state_saver_) {
+        // события сегментов до контрольной точки больше не нужны
+        std::weak_ptr<journal::Journal> weak_journal = journal_;
+        state_saver_->SetOnSaved([weak_journal](const serialization::GameStateRepr& state) {
+            if (auto journal = weak_journal.lock()) {
+                journal->RemoveSegmentsBefore(state.journal_segment);
+            }
+        });
+    }
+}
+
+serialization::GameStateRepr Game::CaptureState() const {
+    serialization::GameStateRepr state;
     
-    // Сериализуем весь лут
-    std::vector<serialization::LootRepr> loots_to_serialize;
-    for (auto session : sessions_) {
-        for (auto loot : session->GetLoots()) {
-            loots_to_serialize.push_back(serialization::LootRepr(std::make_shared<Loot>(loot)));
+    // Копируем весь лут: лежащий на картах и в рюкзаках собак
+    for (const auto& session : sessions_) {
+        for (const auto& loot : session->GetLoots()) {
+            state.loots.emplace_back(loot);
         }
-        for (auto dog : session->GetDogs()) {
-            for (auto loot : dog->GetBag()) {
-                loots_to_serialize.push_back(serialization::LootRepr(std::make_shared<Loot>(loot)));
+        for (const auto& dog : session->GetDogs()) {
+            for (const auto& loot : dog.GetBag()) {
+                state.loots.emplace_back(loot);
             }
         }
     }
-    oa << loots_to_serialize;
     
-    // Сериализуем всех собак
-    std::vector<serialization::DogRepr> dogs_to_serialize;
-    for (auto session : sessions_) {
-        for (auto dog : session->GetDogs()) {
-            dogs_to_serialize.push_back(serialization::DogRepr(dog));
+    for (const auto& session : sessions_) {
+        for (const auto& dog : session->GetDogs()) {
+            state.dogs.emplace_back(dog);
         }
     }
-    oa << dogs_to_serialize;
+    
+    state.sessions.reserve(sessions_.size());
+    for (const auto& session : sessions_) {
+        state.sessions.emplace_back(session);
+    }
+    
+    Players::ForEach([&state](const PlayerShared& player) {
+        state.players.emplace_back(player);
+    });
+    
+    state.journal_segment = journal_segment_;
+    state.next_loot_id = Loot::NextId();
+    state.next_session_id = GameSession::NextId();
+    if (loot_generator_) {
+        state.loot_time_without_loot = loot_generator_->GetTimeWithoutLoot().count();
+    }
+    
+    return state;
+}
+
+void Game::SaveState() {
+    if (!state_saver_) {
+        return;
+    }
+    
+    TRACE_SPAN("state.save");
+    StartCheckpoint();
+    state_saver_->Save(CaptureState());
+}
 
-    // Сериализуем все сессии
-    std::vector<serialization::GameSessionRepr> sessions_to_serialize;
-    for (auto session : sessions_) {
-        sessions_to_serialize.push_back(serialization::GameSessionRepr(session));
+void Game::StartCheckpoint() {
+    // события после снимка пойдут в новый сегмент журнала
+    if (journal_) {
+        journal_segment_ = journal_->Rotate();
     }
-    oa << sessions_to_serialize;
+}
+
+bool Game::SaveStateAsync() {
+    static auto& capture_duration = metrics::Registry::Instance().GetHistogram(
+        "state_capture_duration_seconds", "Time the game strand spends copying state for a save");
     
-    // Сериализуем всех пользователей
-    std::vector<serialization::PlayerRepr> players_to_serialize;
-    for (const auto& player : Players::GetAllPlayers()) {
-        players_to_serialize.push_back(serialization::PlayerRepr(player));
+    // пока идет предыдущее сохранение, сегмент журнала не меняется и копия не снимается
+    if (!state_saver_ || state_saver_->SkipIfBusy()) {
+        return false;
     }
-    oa << players_to_serialize;
     
-    fs::rename(temp_path, fs::path(save_file_));
+    TRACE_SPAN("state.capture");
+    metrics::Stopwatch stopwatch;
+    StartCheckpoint();
+    auto state = CaptureState();
+    stopwatch.Lap(capture_duration);
+    
+    return state_saver_->SaveAsync(std::move(state));
 }
 
 void Game::LoadState() {
-    using InputArchive = boost::archive::text_iarchive;
-    std::ifstream ifs(save_file_);
-    if (!ifs) throw std::runtime_error("Cannot open file for loading state");
-    InputArchive ia(ifs);
-    
-    // Десериализуем лут
-    std::vector<serialization::LootRepr> loots_repr;
-    ia >> loots_repr;
-    std::vector<LootShared> loots_restored;
-    for (const auto& repr : loots_repr) {
-        loots_restored.push_back(repr.Restore());
-    }
-    
-    // Десериализуем собак
-    std::vector<serialization::DogRepr> dogs_repr;
-    ia >> dogs_repr;
-    std::vector<DogShared> dogs_restored;
-    for (const auto& repr : dogs_repr) {
-        dogs_restored.push_back(std::make_shared<model::Dog>(repr.Restore(loots_restored)));
-    }
-
-    // Десериализуем сессии
-    std::vector<serialization::GameSessionRepr> sessions_repr;
-    ia >> sessions_repr;
+    RestoreState(serialization::ReadState(save_file_));
+}
+
+void Game::RestoreState(const serialization::GameStateRepr& state) {
+    // Восстановленные объекты индексируются по id, поэтому связи между ними
+    // (рюкзаки, состав сессий, игроки) восстанавливаются за линейное время
+    
+    // Восстанавливаем лут
+    serialization::LootIndex loots_restored;
+    loots_restored.reserve(state.loots.size());
+    for (const auto& repr : state.loots) {
+        auto loot = repr.Restore();
+        Loot::ReserveId(loot.GetId());
+        loots_restored.emplace(loot.GetId(), std::move(loot));
+    }
+    
+    // Восстанавливаем собак
+    serialization::DogIndex dogs_restored;
+    dogs_restored.reserve(state.dogs.size());
+    for (const auto& repr : state.dogs) {
+        auto dog = repr.Restore(loots_restored);
+        Dog::ReserveId(dog.GetId());
+        dogs_restored.emplace(dog.GetId(), std::move(dog));
+    }
+
+    // Восстанавливаем сессии
     sessions_.clear();
-    std::vector<GameSessionShared> sessions_restored;
-    for (const auto& repr : sessions_repr) {
-        sessions_restored.push_back(repr.Restore(*this, dogs_restored, loots_restored));
+    sessions_by_map_.clear();
+    sessions_.reserve(state.sessions.size());
+    serialization::GameSessionIndex sessions_restored;
+    sessions_restored.reserve(state.sessions.size());
+    // собаки переносятся в пулы сессий, игроки находят их по ручкам
+    serialization::DogHandleIndex dog_handles;
+    dog_handles.reserve(dogs_restored.size());
+    for (const auto& repr : state.sessions) {
+        auto session = repr.Restore(*this, dogs_restored, loots_restored, dog_handles);
+        session->SetMapsGeneration(maps_->GetGeneration());
+        GameSession::ReserveId(session->GetId());
+        sessions_restored.emplace(session->GetId(), session);
+        AddSession(std::move(session));
     }
     
-    sessions_ = sessions_restored;
+    for (auto& session : sessions_) {
+        session->PublishSnapshot();
+    }
 
-     // Десериализуем игроков
-     std::vector<serialization::PlayerRepr> players_repr;
-     ia >> players_repr;
-     std::vector<PlayerShared> players_restored;
-     for (const auto& repr : players_repr) {
-         players_restored.push_back(repr.Restore(*this, dogs_restored, sessions_restored));
-     }
-     Players::SetAllPlayers(players_restored);
+    // Восстанавливаем игроков
+    std::vector<PlayerShared> players_restored;
+    players_restored.reserve(state.players.size());
+    for (const auto& repr : state.players) {
+        players_restored.push_back(repr.Restore(*this, dog_handles, sessions_restored));
+        Player::ReserveId(players_restored.back()->Id());
+    }
+    Players::SetAllPlayers(players_restored);
+    
+    if (loot_generator_) {
+        loot_generator_->SetTimeWithoutLoot(loot_gen::LootGenerator::TimeInterval{state.loot_time_without_loot});
+    }
+    journal_segment_ = state.journal_segment;
+    
+    // ReserveId(id) выдает следующим объектам id не меньше id + 1
+    if (state.next_loot_id > 0) {
+        Loot::ReserveId(state.next_loot_id - 1);
+    }
+    if (state.next_session_id > 0) {
+        GameSession::ReserveId(state.next_session_id - 1);
+    }
 }
 
 }  // namespace model
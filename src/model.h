@@ -2,12 +2,19 @@
 
 #include "loot_generator.h"
 #include "postgres.h"
+#include <array>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include <memory>
 #include <iostream>
 #include "tagged.h"
+#include "mpsc_queue.h"
+#include "journal.h"
+#include "tick_arena.h"
+#include "entity_pool.h"
+#include <memory_resource>
+#include <span>
 #include <random>
 #include <cmath>
 #include <algorithm>
@@ -17,6 +24,15 @@
 #include <fstream>
 #include <atomic>
 
+namespace serialization {
+struct GameStateRepr;
+class StateSaver;
+}
+
+namespace recording {
+class Recorder;
+}
+
 namespace model {
 
 inline constexpr double ROAD_BOUNDARY_OFFSET = 0.4;
@@ -36,15 +52,20 @@ class Road;
 class Loot;
 
 using GameSessionShared = std::shared_ptr<GameSession>;
-using DogShared = std::shared_ptr<Dog>;
-using MapShared = std::shared_ptr<Map>;
+using MapShared = std::shared_ptr<const Map>;
 using LootShared = std::shared_ptr<Loot>;
 using LootGeneratorShared = std::shared_ptr<LootGenerator>;
 
-using Dogs = std::vector<DogShared>;
 using Roads = std::vector<Road>;
 using Loots = std::vector<Loot>;
 
+// Поднимает счетчик id так, чтобы следующий выданный id был больше id
+inline void RaiseCounter(std::atomic<int>& counter, int id) noexcept {
+    int current = counter.load(std::memory_order_relaxed);
+    while (current <= id && !counter.compare_exchange_weak(current, id + 1, std::memory_order_relaxed)) {
+    }
+}
+
 struct Point {
     Coord x, y;
 };
@@ -84,6 +105,9 @@ enum class Direction {
 
 class Loot {
 public:
+    // Пустой предмет для ячеек рюкзака; id не расходует
+    Loot() = default;
+    
     Loot(int type, Coords position) :
     id_(counter_++), type_(type), position_(position) {}
     
@@ -114,14 +138,105 @@ public:
         return id_;
     }
     
+    // Вызывается для восстановленных объектов, чтобы новые id с ними не совпадали
+    static void ReserveId(int id) noexcept {
+        RaiseCounter(counter_, id);
+    }
+    
+    // Id, который получит следующий созданный объект
+    static int NextId() noexcept {
+        return counter_;
+    }
+    
 private:
-    int id_;
-    int type_;
+    int id_ = 0;
+    int type_ = 0;
     Coords position_;
     
     static std::atomic<int> counter_;
 };
 
+/*
+ *  Рюкзак собаки. Предметы лежат прямо в объекте, пока вместимость не больше
+ *  INLINE_CAPACITY (так почти на всех картах), поэтому собака не держит
+ *  отдельного выделения под рюкзак, а копия рюкзака (снимок сессии) не обращается
+ *  к куче. Для большей вместимости предметы хранятся в векторе, выделенном
+ *  сразу на всю вместимость.
+ */
+class Bag {
+public:
+    static constexpr int INLINE_CAPACITY = 4;
+    
+    explicit Bag(int capacity = 3) {
+        SetCapacity(capacity);
+    }
+    
+    void SetCapacity(int capacity) {
+        capacity_ = capacity;
+        if (capacity_ > INLINE_CAPACITY) {
+            Spill();
+            spill_.reserve(static_cast<std::size_t>(capacity_));
+        }
+    }
+    
+    int Capacity() const noexcept {
+        return capacity_;
+    }
+    
+    int Size() const noexcept {
+        return spilled_ ? static_cast<int>(spill_.size()) : size_;
+    }
+    
+    bool IsFull() const noexcept {
+        return Size() >= capacity_;
+    }
+    
+    // Вместимость не проверяется: восстановленный рюкзак может быть полнее текущей
+    void Push(const Loot& loot) {
+        if (!spilled_ && size_ < INLINE_CAPACITY) {
+            inline_[static_cast<std::size_t>(size_++)] = loot;
+            return;
+        }
+        Spill();
+        spill_.push_back(loot);
+    }
+    
+    void Clear() noexcept {
+        size_ = 0;
+        spill_.clear();
+    }
+    
+    std::span<const Loot> Items() const noexcept {
+        if (spilled_) {
+            return spill_;
+        }
+        return {inline_.data(), static_cast<std::size_t>(size_)};
+    }
+    
+    const Loot* begin() const noexcept {
+        return Items().data();
+    }
+    
+    const Loot* end() const noexcept {
+        return begin() + Size();
+    }
+    
+private:
+    void Spill() {
+        if (!spilled_) {
+            spill_.assign(inline_.begin(), inline_.begin() + size_);
+            size_ = 0;
+            spilled_ = true;
+        }
+    }
+    
+    std::array<Loot, INLINE_CAPACITY> inline_;
+    int size_ = 0;          // предметов в inline_, пока не spilled_
+    int capacity_ = 0;
+    bool spilled_ = false;
+    std::vector<Loot> spill_;
+};
+
 class Road {
     struct HorizontalTag {
         HorizontalTag() = default;
@@ -168,9 +283,9 @@ public:
         return std::fabs(start_.y - end_.y);
     }
     
-    Coords GetRandomCords(double len);
-    bool PointIsInside(Coords point);
-    Coords GetLastPointOnRoad(Coords start, Coords end);
+    Coords GetRandomCords(double len) const;
+    bool PointIsInside(Coords point) const;
+    Coords GetLastPointOnRoad(Coords start, Coords end) const;
 
 private:
     Point start_;
@@ -219,6 +334,15 @@ private:
     Offset offset_;
 };
 
+// Тип лута карты; номер типа - индекс в Map::GetLootTypes
+struct LootType {
+    std::string name;
+    int value = 0;
+    std::string json;   // описание из конфига для /api/v1/maps/{id}
+};
+
+using LootTypes = std::vector<LootType>;
+
 class Map {
 public:
     using Id = util::Tagged<std::string, Map>;
@@ -280,32 +404,28 @@ public:
         return default_bag_capacity_;
     }
     
-    void SetNumberOfLootOptions(int number) {
-        number_of_loot_options_ = number;
+    // Типы лута в порядке номеров
+    void SetLootTypes(LootTypes loot_types) {
+        loot_types_ = std::move(loot_types);
     }
     
-    void SetNamesOfLootsToNumbers(std::unordered_map<std::string, int> name_of_loot_to_number) {
-        name_of_loot_to_number_ = name_of_loot_to_number;
+    const LootTypes& GetLootTypes() const noexcept {
+        return loot_types_;
     }
     
-    void SetNumberOfLootsToValue(std::unordered_map<int, int> number_of_loot_to_value) {
-        number_of_loot_to_value_ = number_of_loot_to_value;
+    // Неизвестный тип (например, из состояния под другой конфиг) ничего не стоит
+    int GetValueOfLoot(int type) const noexcept {
+        const auto index = static_cast<std::size_t>(type);
+        return index < loot_types_.size() ? loot_types_[index].value : 0;
     }
     
-    int GetNumberOfLoot(const std::string& name) {
-        return name_of_loot_to_number_[name];
+    int GetNumberOfLootOptions() const noexcept {
+        return static_cast<int>(loot_types_.size());
     }
     
-    int GetValueOfLoot(int type) {
-        return number_of_loot_to_value_[type];
-    }
-    
-    int GetNumberOfLootOptions() {
-        return number_of_loot_options_;
-    }
-    
-    Coords GetRandomCordsOnMap();
-    Coords GetFirstCordsOnMap();
+    Coords GetRandomCordsOnMap() const;
+    Coords GetRandomCordsOnMap(std::mt19937_64& random) const;
+    Coords GetFirstCordsOnMap() const;
     
 private:
     using OfficeIdToIndex = std::unordered_map<Office::Id, size_t, util::TaggedHasher<Office::Id>>;
@@ -321,26 +441,84 @@ private:
     double default_dog_speed_ = 1;
     int default_bag_capacity_ = 3;
     
-    int number_of_loot_options_;
-    std::unordered_map<std::string, int> name_of_loot_to_number_;
-    std::unordered_map<int, int> number_of_loot_to_value_;
+    LootTypes loot_types_;
+};
+
+// Готовые тела ответов /api/v1/maps и /api/v1/maps/{id} для одного набора карт
+struct MapResponses {
+    std::string maps;
+    std::unordered_map<std::string, std::string> map_by_id;
 };
 
+/*
+ *  Набор карт игры. Собирается при загрузке конфигурации и после публикации
+ *  не меняется: при перезагрузке конфигурации игра целиком заменяет его новым.
+ *  Карты неизменяемы, и все сессии карты ссылаются на один ее экземпляр;
+ *  сессии прежнего набора держат его карты, пока не доиграют.
+ */
+class MapCatalog {
+public:
+    using Maps = std::vector<MapShared>;
+    
+    MapCatalog() : generation_(next_generation_++) {}
+    
+    // Используется только при сборке набора
+    void AddMap(Map map);
+    
+    const Maps& GetMaps() const noexcept {
+        return maps_;
+    }
+    
+    // Карта с данным id или nullptr
+    MapShared FindMap(const Map::Id& id) const noexcept {
+        auto it = map_id_to_index_.find(id);
+        return it != map_id_to_index_.end() ? maps_[it->second] : nullptr;
+    }
+    
+    // Номер набора: у каждого собранного набора свой
+    std::uint64_t GetGeneration() const noexcept {
+        return generation_;
+    }
+    
+    // Готовые ответы API этого набора или nullptr, если их еще не построили.
+    // Ответы строятся по неизменяемым картам, поэтому задать их можно из любого потока
+    std::shared_ptr<const MapResponses> GetResponses() const noexcept {
+        return std::atomic_load_explicit(&responses_, std::memory_order_acquire);
+    }
+    
+    void SetResponses(std::shared_ptr<const MapResponses> responses) const noexcept {
+        std::atomic_store_explicit(&responses_, std::move(responses), std::memory_order_release);
+    }
+    
+private:
+    using MapIdHasher = util::TaggedHasher<Map::Id>;
+    using MapIdToIndex = std::unordered_map<Map::Id, size_t, MapIdHasher>;
+    
+    Maps maps_;
+    MapIdToIndex map_id_to_index_;
+    std::uint64_t generation_;
+    mutable std::shared_ptr<const MapResponses> responses_;
+    
+    static std::atomic<std::uint64_t> next_generation_;
+};
+
+using MapCatalogShared = std::shared_ptr<const MapCatalog>;
+
 class Dog {
 public:
     
     Dog(std::string name) : id_(counter_++), name_(name) {}
     Dog(int id, std::string name) : id_(id), name_(name) {}
     
-    std::string& GetName() {
+    const std::string& GetName() const noexcept {
         return name_;
     }
     
-    Speed GetSpeed() {
+    Speed GetSpeed() const noexcept {
         return speed_;
     }
     
-    Coords GetCords() {
+    Coords GetCords() const noexcept {
         return cords_;
     }
     
@@ -348,7 +526,7 @@ public:
         cords_ = cords;
     }
     
-    Direction GetDirection() {
+    Direction GetDirection() const noexcept {
         return direction_;
     }
     
@@ -365,24 +543,24 @@ public:
     }
     
     void SetBagCapacity(int capacity) {
-        bag_capacity_ = capacity;
+        bag_.SetCapacity(capacity);
     }
     
-    bool BagIsFull() {
-        return bag_.size() == bag_capacity_;
+    bool BagIsFull() const noexcept {
+        return bag_.IsFull();
     }
     
-    void TakeLoot(Loot loot) {
-        bag_.push_back(loot);
+    void TakeLoot(const Loot& loot) {
+        bag_.Push(loot);
     }
     
     void UnloadBag(MapShared map);
     
-    Loots GetBag() {
+    const Bag& GetBag() const noexcept {
         return bag_;
     }
     
-    int GetScore() {
+    int GetScore() const noexcept {
         return score_;
     }
     
@@ -390,28 +568,34 @@ public:
         score_ = score;
     }
     
-    double GetMapSpeed() {
+    double GetMapSpeed() const noexcept {
         return map_speed_;
     }
     
-    int GetCapacity() {
-        return bag_capacity_;
+    int GetCapacity() const noexcept {
+        return bag_.Capacity();
     }
     
-    int GetId() {
+    int GetId() const noexcept {
         return id_;
     }
     
-    void SetBag(Loots new_bag) {
-        bag_ = new_bag;
+    void SetBag(std::span<const Loot> new_bag) {
+        bag_.Clear();
+        for (const auto& loot : new_bag) {
+            bag_.Push(loot);
+        }
     }
     
     void SetDirection(const std::string& dir);
     Coords GetNewCords(int tick);
-    Coords FindRouteRec(Coords start, Coords end, Roads& roads);
+    // roads - дороги, по которым еще можно продолжить путь; scratch - память для списков дорог
+    Coords FindRouteRec(Coords start, Coords end, std::span<const Road* const> roads,
+                        std::pmr::memory_resource* scratch);
     
     // изменение координат с течением времени
-    void UpdateTickState(int tick, MapShared map);
+    void UpdateTickState(int tick, const MapShared& map,
+                         std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
     
     void SetFullTime(int full_time) {
         full_time_ = full_time;
@@ -421,18 +605,28 @@ public:
         retire_time_ = retire_time;
     }
 
-    int GetFullTime() {
+    int GetFullTime() const noexcept {
         return full_time_;
     }
 
-    int GetRetireTime() {
+    int GetRetireTime() const noexcept {
         return retire_time_;
     }
     
-    bool IsGoingToRetire(int retire_time) {
+    bool IsGoingToRetire(int retire_time) const noexcept {
         return retire_time_ >= retire_time;
     }
     
+    // Вызывается для восстановленных объектов, чтобы новые id с ними не совпадали
+    static void ReserveId(int id) noexcept {
+        RaiseCounter(counter_, id);
+    }
+    
+    // Id, который получит следующий созданный объект
+    static int NextId() noexcept {
+        return counter_;
+    }
+    
 private:
     int id_;
     std::string name_;
@@ -441,9 +635,8 @@ private:
     Direction direction_ = Direction::NORTH;
     
     double map_speed_ = 1;
-    int bag_capacity_ = 3;
     int score_ = 0;
-    Loots bag_;
+    Bag bag_;
     
     int full_time_ = 0;
     int retire_time_ = 0;
@@ -451,6 +644,37 @@ private:
     static std::atomic<int> counter_;
 };
 
+// Собаки сессии лежат подряд в пуле; игроки и команды ссылаются на них ручками
+using DogPool = util::EntityPool<Dog>;
+using DogHandle = DogPool::Handle;
+
+// Снимок собаки для ответов API
+struct DogSnapshot {
+    int id;
+    std::string name;
+    Coords cords;
+    Speed speed;
+    Direction direction;
+    Bag bag;
+    int score;
+};
+
+// Неизменяемый снимок состояния сессии. Публикуется в strand игры,
+// а читается из любого потока без блокировки strand
+struct SessionSnapshot {
+    std::uint64_t version = 0;
+    std::vector<DogSnapshot> dogs;
+    Loots loots;
+};
+
+using SessionSnapshotShared = std::shared_ptr<const SessionSnapshot>;
+
+// Команда игрока, которая применяется к собаке в начале ближайшего тика
+struct PlayerAction {
+    DogHandle dog;
+    std::string move;
+};
+
 class GameSession {
 public:
     
@@ -461,48 +685,111 @@ public:
         return map_->GetId();
     }
     
-    void AddDog(DogShared dog) {
-        dogs_.push_back(dog);
+    // Номер набора карт, из которого взята карта сессии
+    std::uint64_t GetMapsGeneration() const noexcept {
+        return maps_generation_;
+    }
+    
+    void SetMapsGeneration(std::uint64_t generation) noexcept {
+        maps_generation_ = generation;
+    }
+    
+    DogHandle AddDog(Dog dog) {
+        const auto handle = dogs_.Add(std::move(dog));
+        // генератор не кладет на карту больше предметов, чем собак
+        loots_.reserve(dogs_.Size());
+        return handle;
+    }
+    
+    // Собака по ручке или nullptr, если она уже ушла на покой
+    Dog* FindDog(DogHandle handle) noexcept {
+        return dogs_.Get(handle);
     }
     
-    Dogs& GetDogs() noexcept {
+    DogPool& GetDogs() noexcept {
         return dogs_;
     }
     
-    const Loots& GetLoots() {
-        return loots_;
+    const DogPool& GetDogs() const noexcept {
+        return dogs_;
     }
     
-    int GetNumberOfLoot(const std::string& name) {
-        return map_->GetNumberOfLoot(name);
+    const Loots& GetLoots() {
+        return loots_;
     }
     
-    void UpdateTickState(int tick, LootGeneratorShared loot_generator, PoolShared pool, int retire_trashhold);
+    // random - генератор тика (инициализируется зерном, записанным в журнал),
+    // events - получатель событий (журнал, запись сеанса) или nullptr,
+    // scratch - память для временных объектов тика (освобождается после тика)
+    void UpdateTickState(int tick, LootGeneratorShared loot_generator, postgres::RecordStore* records, int retire_trashhold,
+                         std::mt19937_64& random, journal::EventSink* events, std::pmr::memory_resource* scratch);
     
     int GetId() {
         return id_;
     }
     
-    void AddDogs(Dogs dogs) {
-        dogs_ = dogs;
-    }
-    
     void AddLoots(Loots loots) {
         loots_ = loots;
     }
     
+    // Может вызываться из любого потока, не дожидаясь strand игры
+    void EnqueueAction(PlayerAction action) {
+        actions_.Push(std::move(action));
+    }
+    
+    // Последний опубликованный снимок, может вызываться из любого потока
+    SessionSnapshotShared GetSnapshot() const {
+        return std::atomic_load_explicit(&snapshot_, std::memory_order_acquire);
+    }
+    
+    // Копирует текущее состояние в новый снимок и атомарно подменяет им прежний.
+    // Вызывается в strand игры в конце тика и после изменения состава сессии.
+    // Снимок, который уже никто не читает, заполняется заново без выделения памяти
+    void PublishSnapshot();
+    
+    // Вызывается для восстановленных объектов, чтобы новые id с ними не совпадали
+    static void ReserveId(int id) noexcept {
+        RaiseCounter(counter_, id);
+    }
+    
+    // Id, который получит следующий созданный объект
+    static int NextId() noexcept {
+        return counter_;
+    }
+    
 private:
+    // применяет накопленные команды, для каждой собаки - только последнюю
+    void ApplyActions(journal::EventSink* events, std::pmr::memory_resource* scratch);
+    
     int id_;
     MapShared map_;
-    Dogs dogs_;
+    std::uint64_t maps_generation_ = 0;
+    DogPool dogs_;
     Loots loots_;
+    util::MpscQueue<PlayerAction> actions_;
+    
+    SessionSnapshotShared snapshot_ = std::make_shared<SessionSnapshot>();
+    // предыдущий опубликованный снимок, переиспользуется после того, как его отпустят читатели
+    std::shared_ptr<SessionSnapshot> spare_snapshot_;
+    std::uint64_t snapshot_version_ = 0;
     
     static std::atomic<int> counter_;
 };
 
+// Собака в игре: сессия и ручка собаки в ее пуле
+struct DogRef {
+    GameSessionShared session;
+    DogHandle handle;
+    
+    // nullptr, если собаки уже нет
+    Dog* Get() const noexcept {
+        return session ? session->FindDog(handle) : nullptr;
+    }
+};
+
 class Game {
 public:
-    using Maps = std::vector<Map>;
+    using Maps = MapCatalog::Maps;
 
     void AddMap(Map map);
     
@@ -518,21 +805,30 @@ public:
         return default_dog_speed_;
     }
     
+    int GetBagCapacity() const noexcept {
+        return default_bag_capacity_;
+    }
+    
+    // Карты текущего набора. Ссылка действительна до замены набора (ReplaceMaps),
+    // поэтому вне strand игры нужно держать сам набор (GetMapCatalog)
     const Maps& GetMaps() const noexcept {
-        return maps_;
+        return maps_->GetMaps();
     }
     
-    void UpdateTickState(int tick) {
-        
-        for (auto session : sessions_) {
-            session->UpdateTickState(tick, loot_generator_, connection_pool_, retire_time_);
-        }
-        
-        if (need_to_save_manually) {
-            SaveState();
-        }
+    MapCatalogShared GetMapCatalog() const noexcept {
+        return maps_;
     }
     
+    // Заменяет набор карт и параметры новых собак. Вызывается в strand игры.
+    // Новые игроки попадают в сессии на картах нового набора, а сессии на картах
+    // прежнего доигрывают и удаляются, когда в них не остается собак
+    void ReplaceMaps(MapCatalogShared maps, double default_dog_speed, int default_bag_capacity);
+    
+    void UpdateTickState(int tick);
+    
+    // Тик с заданным зерном генератора случайных чисел, повторяется при восстановлении из журнала
+    void UpdateTickState(int tick, std::uint64_t seed);
+    
     void UpdateTickState(std::chrono::milliseconds delta) {
         UpdateTickState(static_cast<int>(delta.count()));
     }
@@ -545,7 +841,7 @@ public:
         tick_period_ = tick_period;
     }
     
-    bool IsInTestState() {
+    bool IsInTestState() const {
         if (tick_period_) {
             return false;
         }
@@ -556,47 +852,110 @@ public:
         loot_generator_ = generator;
     }
     
+    LootGeneratorShared GetGenerator() const noexcept {
+        return loot_generator_;
+    }
+    
     void LoadState();
+    
+    // Восстанавливает игру из прочитанного состояния (используется LoadState)
+    void RestoreState(const serialization::GameStateRepr& state);
+    
+    // Сохраняет состояние в вызывающем потоке (при завершении работы)
     void SaveState();
     
-    void SetSaveFile(std::string file) {
-        save_file_ = file;
+    // Снимает копию состояния и передает ее на запись в фоновый поток.
+    // Вызывается в strand игры. Возвращает false, если предыдущее
+    // сохранение еще не завершено
+    bool SaveStateAsync();
+    
+    // Копия состояния игры для сохранения
+    serialization::GameStateRepr CaptureState() const;
+    
+    void SetSaveFile(std::string file);
+    
+    // Применяет события журнала, записанные после загруженной контрольной точки,
+    // и начинает вести журнал дальше. Вызывается после LoadState
+    void EnableJournal(const journal::Settings& settings);
+    
+    // Начинает запись сеанса для воспроизведения (recording.h). config - содержимое
+    // файла конфигурации, текущее состояние игры становится начальным
+    void StartRecording(const std::string& path, std::string_view config);
+    
+    // Дописывает в запись хеш итогового состояния и закрывает ее
+    void StopRecording();
+    
+    // Получатель событий (журнал и запись сеанса) или nullptr, если события не пишутся
+    journal::EventSink* GetEventSink() noexcept {
+        return events_.Empty() ? nullptr : &events_;
     }
     
+    using DogsById = std::unordered_map<int, DogRef>;
+    
+    // Собаки всех сессий по id, для повтора событий
+    DogsById IndexDogs() const;
+    
+    // Повторяет событие журнала или записи сеанса. Вход игрока добавляет собаку в dogs
+    void ReplayEvent(const journal::Event& event, DogsById& dogs);
+    
     void SetManualSerialization(bool need_to_save) {
         need_to_save_manually = need_to_save;
     }
     
     MapShared FindMap(Map::Id id) const {
-        return std::make_shared<Map>(maps_[map_id_to_index_.at(id)]);
+        MapShared map = maps_->FindMap(id);
+        if (!map) {
+            throw std::out_of_range("Map " + *id + " not found");
+        }
+        return map;
     }
     
-    void SetPool(PoolShared pool) {
-        connection_pool_ = pool;
+    // Хранилище рекордов ушедших на покой собак (БД или память процесса)
+    void SetRecordStore(postgres::RecordStoreShared records) {
+        record_store_ = std::move(records);
     }
     
-    PoolShared GetPool() {
-        return connection_pool_;
+    postgres::RecordStoreShared GetRecordStore() const noexcept {
+        return record_store_;
     }
     
     void SetRetireTime(int retire_time) {
         retire_time_ = retire_time;
     }
     
-    int GetRetireTime() {
+    int GetRetireTime() const noexcept {
         return retire_time_;
     }
     
-    GameSessionShared AddDogToSession(DogShared dog, const std::string map);
+    // Сколько собак принимает одна сессия, 0 - без ограничения. Новая собака попадает
+    // в наименее загруженную сессию своей карты, а когда заполнены все, создается новая
+    void SetMaxSessionDogs(int max_dogs) {
+        max_session_dogs_ = max_dogs;
+    }
+    
+    int GetMaxSessionDogs() const noexcept {
+        return max_session_dogs_;
+    }
+    
+    std::size_t GetSessionsCount() const noexcept {
+        return sessions_.size();
+    }
+    
+    // Настраивает собаку под карту и добавляет в сессию; session пуст, если карты нет
+    DogRef AddDogToSession(Dog dog, const std::string& map);
     
 private:
-    using MapIdHasher = util::TaggedHasher<Map::Id>;
-    using MapIdToIndex = std::unordered_map<Map::Id, size_t, MapIdHasher>;
-
-    std::vector<Map> maps_;
-    MapIdToIndex map_id_to_index_;
+    using SessionsByMap = std::unordered_map<Map::Id, std::vector<GameSessionShared>, util::TaggedHasher<Map::Id>>;
+    
+    // Добавляет сессию в игру и в индекс сессий ее карты
+    void AddSession(GameSessionShared session);
+    
+    MapCatalogShared maps_ = std::make_shared<MapCatalog>();
     
     std::vector<GameSessionShared> sessions_;
+    // сессии на картах текущего набора, в которые попадают новые собаки
+    SessionsByMap sessions_by_map_;
+    int max_session_dogs_ = 0;
     
     double default_dog_speed_ = 1;
     int default_bag_capacity_ = 3;
@@ -607,11 +966,24 @@ private:
     LootGeneratorShared loot_generator_;
     
     std::string save_file_;
-    bool need_to_save_manually;
+    std::shared_ptr<serialization::StateSaver> state_saver_;
+    std::shared_ptr<journal::Journal> journal_;
+    std::shared_ptr<recording::Recorder> recorder_;
+    journal::EventSinks events_;
+    // сегмент журнала, с которого начинаются события после загруженной контрольной точки
+    std::uint64_t journal_segment_ = 0;
+    // источник зерен для генераторов тиков
+    std::mt19937_64 seed_generator_{std::random_device{}()};
+    // память для временных объектов тика
+    std::shared_ptr<TickArena> tick_arena_ = std::make_shared<TickArena>();
+    bool need_to_save_manually = false;
     
     int retire_time_;
     
-    PoolShared connection_pool_;
+    postgres::RecordStoreShared record_store_;
+    
+    // Начинает новый сегмент журнала перед снятием копии состояния
+    void StartCheckpoint();
 };
 
 }  // namespace model
@@ -11,6 +11,7 @@
 #include "application.h"
 #include "geom.h"
 #include <algorithm>
+#include <unordered_map>
 
 namespace geom {
 
@@ -75,11 +76,27 @@ void serialize(Archive& ar, model::Offset& offset, [[maybe_unused]] const unsign
 
 namespace serialization {
 
-using DogSharedPtr = std::shared_ptr<model::Dog>;
+class BinaryStateFormat;
+
 using GameSessionSharedPtr = std::shared_ptr<model::GameSession>;
 using PlayerSharedPtr = std::shared_ptr<Player>;
 using LootSharedPtr = std::shared_ptr<model::Loot>;
-using MapSharedPtr = std::shared_ptr<model::Map>;
+using MapSharedPtr = model::MapShared;
+
+// Восстановленные объекты по id: строятся один раз при загрузке,
+// чтобы восстановление связей между объектами шло за линейное время
+using LootIndex = std::unordered_map<int, model::Loot>;
+using DogIndex = std::unordered_map<int, model::Dog>;
+// Ручки собак в пулах восстановленных сессий
+using DogHandleIndex = std::unordered_map<int, model::DogHandle>;
+using GameSessionIndex = std::unordered_map<int, GameSessionSharedPtr>;
+
+// Объект с данным id или nullptr
+template <typename Index>
+const typename Index::mapped_type* FindRestored(const Index& index, int id) {
+    auto it = index.find(id);
+    return it != index.end() ? &it->second : nullptr;
+}
 
 // LootRepr (LootsRepresentation) - сериализованное представление класса Loot
 class LootRepr {
@@ -93,9 +110,15 @@ public:
     {
     }
     
-    [[nodiscard]] LootSharedPtr Restore() const {
-        LootSharedPtr result = std::make_shared<model::Loot>(id_, loot_type_, position_);
-        return result;
+    explicit LootRepr(const model::Loot& loot)
+        : id_(loot.GetId())
+        , loot_type_(loot.GetType())
+        , position_(loot.GetPosition())
+    {
+    }
+    
+    [[nodiscard]] model::Loot Restore() const {
+        return model::Loot(id_, loot_type_, position_);
     }
     
     template <typename Archive>
@@ -106,6 +129,8 @@ public:
     }
     
 private:
+    friend class BinaryStateFormat;
+    
     int id_;
     int loot_type_;
     model::Coords position_;
@@ -116,24 +141,25 @@ class DogRepr {
 public:
     DogRepr() = default;
     
-    explicit DogRepr(DogSharedPtr dog)
-        : name_(dog->GetName())
-        , cords_(dog->GetCords())
-        , speed_(dog->GetSpeed())
-        , direction_(dog->GetDirection())
-        , map_speed_(dog->GetMapSpeed())
-        , bag_capacity_(dog->GetCapacity())
-        , score_(dog->GetScore())
-        , full_time_(dog->GetFullTime())
-        , retire_time_(dog->GetRetireTime())
+    explicit DogRepr(const model::Dog& dog)
+        : id_(dog.GetId())
+        , name_(dog.GetName())
+        , cords_(dog.GetCords())
+        , speed_(dog.GetSpeed())
+        , direction_(dog.GetDirection())
+        , map_speed_(dog.GetMapSpeed())
+        , bag_capacity_(dog.GetCapacity())
+        , score_(dog.GetScore())
+        , full_time_(dog.GetFullTime())
+        , retire_time_(dog.GetRetireTime())
     {
-        for (auto loot : dog->GetBag()) {
+        for (const auto& loot : dog.GetBag()) {
             id_loots_in_bag_.push_back(loot.GetId());
         }
     }
     
-    [[nodiscard]] model::Dog Restore(std::vector<model::LootShared> loots) const {
-        model::Dog result(name_);
+    [[nodiscard]] model::Dog Restore(const LootIndex& loots) const {
+        model::Dog result(id_, name_);
         result.SetCords(cords_);
         result.SetMapSpeed(map_speed_);
         result.SetSpeed(speed_);
@@ -142,13 +168,14 @@ public:
         result.SetScore(score_);
         
         model::Loots restored_bag;
-        for (auto loot : loots) {
-            if (std::find(id_loots_in_bag_.begin(), id_loots_in_bag_.end(), loot->GetId()) != id_loots_in_bag_.end()) {
+        restored_bag.reserve(id_loots_in_bag_.size());
+        for (int id : id_loots_in_bag_) {
+            if (auto loot = FindRestored(loots, id)) {
                 restored_bag.push_back(*loot);
             }
         }
         
-        result.SetBag(restored_bag);
+        result.SetBag(std::move(restored_bag));
         result.SetFullTime(full_time_);
         result.SetRetireTime(retire_time_);
         
@@ -171,6 +198,8 @@ public:
     }
     
 private:
+    friend class BinaryStateFormat;
+    
     int id_;
     std::string name_;
     model::Coords cords_;
@@ -196,33 +225,35 @@ public:
             id_loots_.push_back(loot.GetId());
         }
         
-        for (auto& dog : gameSession->GetDogs()) {
-            id_dogs_.push_back(dog->GetId());
+        for (const auto& dog : gameSession->GetDogs()) {
+            id_dogs_.push_back(dog.GetId());
         }
     }
     
+    // Собаки сессии переносятся из dogs_restored в ее пул, их ручки попадают в dog_handles
     [[nodiscard]] GameSessionSharedPtr Restore(const model::Game& game,
-                                               std::vector<DogSharedPtr>& dogs_restored,
-                                               std::vector<LootSharedPtr>& loots_restored) const {
+                                               DogIndex& dogs_restored,
+                                               const LootIndex& loots_restored,
+                                               DogHandleIndex& dog_handles) const {
         
         MapSharedPtr map_ptr = game.FindMap(model::Map::Id(id_map_));
         GameSessionSharedPtr session = std::make_shared<model::GameSession>(id_, map_ptr);
         
-        model::Dogs dogs_to_add;
-        for (auto dog : dogs_restored) {
-            if (std::find(id_dogs_.begin(), id_dogs_.end(), dog->GetId()) != id_dogs_.end()) {
-                dogs_to_add.push_back(dog);
+        session->GetDogs().Reserve(id_dogs_.size());
+        for (int id : id_dogs_) {
+            if (auto node = dogs_restored.extract(id)) {
+                dog_handles[id] = session->AddDog(std::move(node.mapped()));
             }
         }
-        session->AddDogs(dogs_to_add);
         
         model::Loots loots_to_add;
-        for (auto loot : loots_restored) {
-            if (std::find(id_loots_.begin(), id_loots_.end(), loot->GetId()) != id_loots_.end()) {
+        loots_to_add.reserve(id_loots_.size());
+        for (int id : id_loots_) {
+            if (auto loot = FindRestored(loots_restored, id)) {
                 loots_to_add.push_back(*loot);
             }
         }
-        session->AddLoots(loots_to_add);
+        session->AddLoots(std::move(loots_to_add));
         
         return session;
     }
@@ -236,6 +267,8 @@ public:
     }
     
 private:
+    friend class BinaryStateFormat;
+    
     int id_;
     std::string id_map_;
     std::vector<int> id_loots_;
@@ -250,32 +283,26 @@ public:
     explicit PlayerRepr(PlayerSharedPtr player)
         : id_(player->Id())
         , token_(*(player->GetToken()))
-        , dog_id_(player->GetDog()->GetId())
+        , dog_id_(player->GetDogId())
         , session_id_(player->GetSession()->GetId())
     {
     }
     
     [[nodiscard]] PlayerSharedPtr Restore(const model::Game& game,
-                                         std::vector<DogSharedPtr>& dogs_restored,
-                                         std::vector<GameSessionSharedPtr>& sessions_restored) const {
+                                         const DogHandleIndex& dogs_restored,
+                                         const GameSessionIndex& sessions_restored) const {
         
-        DogSharedPtr dog_to_add;
-        for (auto& dog : dogs_restored) {
-            if (dog->GetId() == dog_id_) {
-                dog_to_add = dog;
-                break;
-            }
+        model::DogHandle dog_to_add;
+        if (auto dog = FindRestored(dogs_restored, dog_id_)) {
+            dog_to_add = *dog;
         }
         
         GameSessionSharedPtr session_to_add;
-        for (auto& session : sessions_restored) {
-            if (session->GetId() == session_id_) {
-                session_to_add = session;
-                break;
-            }
+        if (auto session = FindRestored(sessions_restored, session_id_)) {
+            session_to_add = *session;
         }
         
-        PlayerSharedPtr result = std::make_shared<Player>(id_, token_, dog_to_add, session_to_add);
+        PlayerSharedPtr result = std::make_shared<Player>(id_, token_, dog_to_add, dog_id_, session_to_add);
         return result;
     }
     
@@ -288,10 +315,49 @@ public:
     }
     
 private:
+    friend class BinaryStateFormat;
+    
     uint64_t id_;
     std::string token_;
     int dog_id_;
     int session_id_;
 };
 
+// Копия всего состояния игры, которая снимается в strand игры
+// и дальше сохраняется независимо от игровой модели
+struct GameStateRepr {
+    std::vector<LootRepr> loots;
+    std::vector<DogRepr> dogs;
+    std::vector<GameSessionRepr> sessions;
+    std::vector<PlayerRepr> players;
+    
+    // сегмент журнала, с которого начинаются события после этой контрольной точки
+    std::uint64_t journal_segment = 0;
+    // время без появления лута у генератора, мс
+    std::int64_t loot_time_without_loot = 0;
+    // id, которые получат следующие лут и сессия. Лут и сессии создаются и без
+    // событий журнала, поэтому после повтора журнала их id должны продолжиться
+    // с момента снимка, а не с наибольшего id среди сохраненных объектов
+    int next_loot_id = 0;
+    int next_session_id = 0;
+    
+    // Порядок частей совпадает с текстовым форматом файла сохранения
+    // (в нем нет сегмента журнала и состояния генератора)
+    template <typename Archive>
+    void Write(Archive& ar) const {
+        ar << loots;
+        ar << dogs;
+        ar << sessions;
+        ar << players;
+    }
+    
+    template <typename Archive>
+    void Read(Archive& ar) {
+        ar >> loots;
+        ar >> dogs;
+        ar >> sessions;
+        ar >> players;
+    }
+};
+
 } // namespace serialization
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+namespace util {
+
+/*
+ *  Неблокирующая очередь "много писателей - один читатель".
+ *  Писатели добавляют элементы в стек Трайбера одной операцией CAS,
+ *  читатель забирает весь стек целиком и обходит его в порядке добавления.
+ */
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() = default;
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue() {
+        DeleteList(head_.exchange(nullptr, std::memory_order_acquire));
+    }
+
+    // Может вызываться из любого потока
+    void Push(T value) {
+        Node* node = new Node{std::move(value), head_.load(std::memory_order_relaxed)};
+        while (!head_.compare_exchange_weak(node->next, node,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+        }
+    }
+
+    // Передает fn все накопленные элементы в порядке добавления.
+    // Должна вызываться только одним потребителем
+    template <typename Fn>
+    void Drain(Fn&& fn) {
+        Node* list = head_.exchange(nullptr, std::memory_order_acquire);
+
+        // стек хранит элементы в обратном порядке - разворачиваем его
+        Node* ordered = nullptr;
+        while (list) {
+            Node* next = list->next;
+            list->next = ordered;
+            ordered = list;
+            list = next;
+        }
+
+        while (ordered) {
+            std::unique_ptr<Node> node(ordered);
+            ordered = node->next;
+            node->next = nullptr;
+            try {
+                fn(std::move(node->value));
+            } catch (...) {
+                DeleteList(ordered);
+                throw;
+            }
+        }
+    }
+
+    bool Empty() const noexcept {
+        return head_.load(std::memory_order_relaxed) == nullptr;
+    }
+
+private:
+    struct Node {
+        T value;
+        Node* next;
+    };
+
+    static void DeleteList(Node* node) {
+        while (node) {
+            Node* next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    std::atomic<Node*> head_{nullptr};
+};
+
+/*
+ *  Ограниченная неблокирующая кольцевая очередь "много писателей - один читатель"
+ *  (алгоритм Д. Вьюкова). Каждая ячейка хранит номер последовательности,
+ *  по которому писатель понимает, свободна ли ячейка, а читатель - заполнена ли она.
+ *  Емкость округляется вверх до степени двойки.
+ */
+template <typename T>
+class BoundedMpscQueue {
+public:
+    explicit BoundedMpscQueue(std::size_t capacity) {
+        std::size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        cells_ = std::make_unique<Cell[]>(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedMpscQueue(const BoundedMpscQueue&) = delete;
+    BoundedMpscQueue& operator=(const BoundedMpscQueue&) = delete;
+
+    // Может вызываться из любого потока. Возвращает false, если очередь заполнена
+    bool TryPush(T& value) {
+        Cell* cell;
+        std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Должна вызываться только одним потребителем. Возвращает false, если очередь пуста
+    bool TryPop(T& value) {
+        Cell& cell = cells_[dequeue_pos_ & mask_];
+        const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(dequeue_pos_ + 1) < 0) {
+            return false;
+        }
+        value = std::move(cell.value);
+        cell.value = T{};
+        cell.sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+        ++dequeue_pos_;
+        return true;
+    }
+
+    std::size_t Capacity() const noexcept {
+        return mask_ + 1;
+    }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    std::size_t mask_ = 0;
+    alignas(64) std::atomic<std::size_t> enqueue_pos_{0};
+    alignas(64) std::size_t dequeue_pos_ = 0;
+};
+
+}  // namespace util
@@ -1,7 +1,11 @@
 #include "postgres.h"
+#include "trace.h"
 
 #include <pqxx/result.hxx>
 
+#include <algorithm>
+#include <tuple>
+
 namespace postgres {
 
 void DB::Init(PoolShared pool) {
@@ -28,6 +32,8 @@ std::vector<PlayerInfo> DB::GetPlayersInfo(PoolShared pool, int start, int max_i
     start = std::max(0, start);          // Оффсет не может быть отрицательным
     max_items = std::max(1, max_items);  // Лимит не может быть меньше 1
 
+    TRACE_SPAN("db.get_players_info");
+
     std::vector<PlayerInfo> result;
     auto connection = pool->GetConnection();
     pqxx::work work{*connection};
@@ -59,6 +65,7 @@ std::vector<PlayerInfo> DB::GetPlayersInfo(PoolShared pool, int start, int max_i
 }
 
 void DB::SaveRecord(PoolShared pool, PlayerInfo record) {
+    TRACE_SPAN("db.save_record");
 
     auto connection = pool->GetConnection();
     pqxx::work work{*connection};
@@ -79,4 +86,33 @@ void DB::SaveRecord(PoolShared pool, PlayerInfo record) {
     }
 }
 
+namespace {
+
+// Порядок выдачи рекордов, как в ORDER BY запроса к БД
+bool RecordLess(const PlayerInfo& lhs, const PlayerInfo& rhs) {
+    return std::tuple(-lhs.total_score, lhs.full_game_period, lhs.name)
+         < std::tuple(-rhs.total_score, rhs.full_game_period, rhs.name);
+}
+
+} // namespace
+
+void InMemoryRecordStore::SaveRecord(PlayerInfo record) {
+    std::lock_guard lock{mutex_};
+    auto it = std::upper_bound(records_.begin(), records_.end(), record, RecordLess);
+    records_.insert(it, std::move(record));
+}
+
+PlayersInfo InMemoryRecordStore::GetPlayersInfo(int start, int max_items) {
+    start = std::max(0, start);
+    max_items = std::max(1, max_items);
+
+    std::lock_guard lock{mutex_};
+    if (static_cast<size_t>(start) >= records_.size()) {
+        return {};
+    }
+    const auto first = records_.begin() + start;
+    const auto last = first + std::min<size_t>(max_items, records_.end() - first);
+    return {first, last};
+}
+
 };
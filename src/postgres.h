@@ -1,5 +1,11 @@
+#pragma once
+
 #include "connection_pool.h"
 
+#include <memory>
+#include <mutex>
+#include <vector>
+
 namespace postgres {
 
 struct PlayerInfo {
@@ -17,4 +23,46 @@ public:
     static void SaveRecord(PoolShared pool, PlayerInfo record);
 };
 
+// Хранилище рекордов собак, ушедших на покой
+class RecordStore {
+public:
+    virtual ~RecordStore() = default;
+
+    virtual void SaveRecord(PlayerInfo record) = 0;
+
+    // Рекорды по убыванию очков (при равенстве - по времени игры и имени)
+    virtual PlayersInfo GetPlayersInfo(int start, int max_items) = 0;
+};
+
+using RecordStoreShared = std::shared_ptr<RecordStore>;
+
+// Рекорды в таблице retired_players через пул соединений
+class PostgresRecordStore : public RecordStore {
+public:
+    explicit PostgresRecordStore(PoolShared pool) : pool_(std::move(pool)) {}
+
+    void SaveRecord(PlayerInfo record) override {
+        DB::SaveRecord(pool_, std::move(record));
+    }
+
+    PlayersInfo GetPlayersInfo(int start, int max_items) override {
+        return DB::GetPlayersInfo(pool_, start, max_items);
+    }
+
+private:
+    PoolShared pool_;
+};
+
+// Рекорды в памяти процесса. Используется, когда GAME_DB_URL не задан
+// (локальный запуск, нагрузочное тестирование); при перезапуске теряются
+class InMemoryRecordStore : public RecordStore {
+public:
+    void SaveRecord(PlayerInfo record) override;
+    PlayersInfo GetPlayersInfo(int start, int max_items) override;
+
+private:
+    std::mutex mutex_;
+    PlayersInfo records_;  // упорядочены так же, как выдача GetPlayersInfo
+};
+
 }
@@ -0,0 +1,167 @@
+#include "recording.h"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#include "application.h"
+#include "byte_codec.h"
+#include "model.h"
+#include "state_format.h"
+
+namespace recording {
+
+namespace {
+
+constexpr codec::Magic MAGIC = {'G', 'S', 'R', 'E', 'C', 'O', 'R', 'D'};
+
+// Вид записи после заголовка
+enum class Entry : std::uint8_t {
+    EVENT = 1,  // время в мкс и событие в формате журнала
+    END         // хеш итогового состояния
+};
+
+using codec::Put;
+
+// config и начальное состояние могут быть больше 4 ГБ
+void PutBlob(std::string& out, std::string_view blob) {
+    codec::PutString<std::uint64_t>(out, blob);
+}
+
+} // namespace
+
+Recorder::Recorder(const std::string& path, std::string_view config, std::string_view initial_state)
+    : out_(path, std::ios::binary | std::ios::trunc)
+    , start_(std::chrono::steady_clock::now()) {
+    if (!out_) {
+        throw std::runtime_error("Cannot open recording file " + path);
+    }
+
+    const auto counters = CaptureIdCounters();
+
+    std::string header;
+    header.append(MAGIC.data(), MAGIC.size());
+    Put(header, RECORDING_VERSION);
+    Put(header, counters.dog);
+    Put(header, counters.loot);
+    Put(header, counters.session);
+    Put(header, counters.player);
+    PutBlob(header, config);
+    PutBlob(header, initial_state);
+    out_.write(header.data(), static_cast<std::streamsize>(header.size()));
+}
+
+void Recorder::Append(const journal::Event& event) {
+    const auto time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_);
+
+    std::lock_guard lock{mutex_};
+    if (finished_) {
+        return;
+    }
+
+    // буфер записи переиспользуется, данные копит буфер потока
+    record_.clear();
+    Put(record_, Entry::EVENT);
+    Put(record_, static_cast<std::uint64_t>(time.count()));
+    journal::EncodeRecord(record_, event);
+    out_.write(record_.data(), static_cast<std::streamsize>(record_.size()));
+}
+
+void Recorder::Finish(std::uint64_t state_hash) {
+    std::lock_guard lock{mutex_};
+    if (finished_) {
+        return;
+    }
+    finished_ = true;
+
+    record_.clear();
+    Put(record_, Entry::END);
+    Put(record_, state_hash);
+    out_.write(record_.data(), static_cast<std::streamsize>(record_.size()));
+    out_.flush();
+}
+
+Recording ReadRecording(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Cannot open recording " + path);
+    }
+    std::string data(static_cast<std::size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    if (!file.read(data.data(), static_cast<std::streamsize>(data.size()))) {
+        throw std::runtime_error("Cannot read recording " + path);
+    }
+
+    codec::ByteReader reader(data, "Recording header");
+    const auto magic = reader.Get<std::array<char, MAGIC.size()>>();
+    if (magic != MAGIC) {
+        throw std::runtime_error(path + " is not a game recording");
+    }
+    if (const auto version = reader.Get<std::uint32_t>(); version != RECORDING_VERSION) {
+        throw std::runtime_error("Unsupported recording version " + std::to_string(version));
+    }
+
+    Recording recording;
+    recording.counters.dog = reader.Get<std::int32_t>();
+    recording.counters.loot = reader.Get<std::int32_t>();
+    recording.counters.session = reader.Get<std::int32_t>();
+    recording.counters.player = reader.Get<std::uint64_t>();
+    recording.config = reader.GetString<std::uint64_t>();
+    recording.initial_state = reader.GetString<std::uint64_t>();
+
+    // хвост, недописанный из-за сбоя, отбрасывается
+    auto& rest = reader.Rest();
+    constexpr std::size_t TIME_SIZE = sizeof(std::uint64_t);
+    while (rest.size() >= sizeof(Entry) + TIME_SIZE) {
+        const auto entry = static_cast<Entry>(rest.front());
+        std::uint64_t value;
+        std::memcpy(&value, rest.data() + sizeof(Entry), sizeof(value));
+
+        if (entry == Entry::END) {
+            recording.final_state_hash = value;
+            break;
+        }
+        if (entry != Entry::EVENT) {
+            break;
+        }
+
+        std::string_view record = rest.substr(sizeof(Entry) + TIME_SIZE);
+        auto event = journal::DecodeRecord(record);
+        if (!event) {
+            break;
+        }
+        recording.events.push_back({std::chrono::microseconds(value), std::move(*event)});
+        rest = record;
+    }
+
+    return recording;
+}
+
+IdCounters CaptureIdCounters() {
+    return {model::Dog::NextId(), model::Loot::NextId(), model::GameSession::NextId(), Player::NextId()};
+}
+
+void RestoreIdCounters(const IdCounters& counters) {
+    // ReserveId(id) выдает следующим объектам id не меньше id + 1
+    if (counters.dog > 0) {
+        model::Dog::ReserveId(counters.dog - 1);
+    }
+    if (counters.loot > 0) {
+        model::Loot::ReserveId(counters.loot - 1);
+    }
+    if (counters.session > 0) {
+        model::GameSession::ReserveId(counters.session - 1);
+    }
+    if (counters.player > 0) {
+        Player::ReserveId(counters.player - 1);
+    }
+}
+
+std::uint64_t StateHash(const model::Game& game) {
+    auto state = game.CaptureState();
+    state.journal_segment = 0;
+    return codec::Checksum(serialization::BinaryStateFormat::Encode(state));
+}
+
+}  // namespace recording
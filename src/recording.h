@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "journal.h"
+
+namespace model {
+class Game;
+}
+
+namespace recording {
+
+/*
+ *  Запись игрового сеанса для детерминированного воспроизведения (--record).
+ *
+ *  В заголовке - содержимое файла конфигурации, начальное состояние игры в двоичном
+ *  формате файла состояния и счетчики id. За ним идут события в формате журнала
+ *  (входы, смены направления, тики с зерном и длительностью) с временем от начала
+ *  записи. При остановке записи дописывается хеш итогового состояния, с которым
+ *  сверяется результат воспроизведения (tools/record_replay.cpp).
+ */
+inline constexpr std::uint32_t RECORDING_VERSION = 1;
+
+// Следующие id объектов на момент начала записи. Часть id к этому моменту могла
+// быть выдана объектам, которых уже нет в состоянии, поэтому счетчики сохраняются отдельно
+struct IdCounters {
+    std::int32_t dog = 0;
+    std::int32_t loot = 0;
+    std::int32_t session = 0;
+    std::uint64_t player = 0;
+};
+
+struct TimedEvent {
+    std::chrono::microseconds time;  // от начала записи
+    journal::Event event;
+};
+
+struct Recording {
+    std::string config;
+    std::string initial_state;
+    IdCounters counters;
+    std::vector<TimedEvent> events;
+    std::optional<std::uint64_t> final_state_hash;  // нет, если запись оборвалась
+};
+
+class Recorder final : public journal::EventSink {
+public:
+    // Создает файл и записывает заголовок
+    Recorder(const std::string& path, std::string_view config, std::string_view initial_state);
+
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    void Append(const journal::Event& event) override;
+
+    // Дописывает хеш итогового состояния. После этого события не принимаются
+    void Finish(std::uint64_t state_hash);
+
+private:
+    std::mutex mutex_;
+    std::ofstream out_;
+    std::string record_;
+    std::chrono::steady_clock::time_point start_;
+    bool finished_ = false;
+};
+
+// Читает запись. Выбрасывает std::runtime_error, если заголовок поврежден;
+// события читаются до первой неполной записи
+Recording ReadRecording(const std::string& path);
+
+// Текущие счетчики id объектов игры
+IdCounters CaptureIdCounters();
+
+// Поднимает счетчики id до сохраненных в записи
+void RestoreIdCounters(const IdCounters& counters);
+
+// Хеш состояния игры (без номера сегмента журнала, который зависит от запуска)
+std::uint64_t StateHash(const model::Game& game);
+
+}  // namespace recording
@@ -49,4 +49,29 @@ std::string FromUrlEncoding(const std::string& str) {
     return result;
 }
 
+StringResponse MakeTraceResponse(unsigned http_version, bool keep_alive) {
+    if constexpr (!trace::ENABLED) {
+        return MakeStringResponse(http::status::not_found, "Tracing is disabled, build with -DGAME_TRACING=ON"sv,
+                                  http_version, keep_alive, ContentType::TEXT_PLAIN, true);
+    }
+    return MakeStringResponse(http::status::ok, trace::DumpChromeJson(), http_version, keep_alive,
+                              ContentType::APPLICATION_JSON, true);
+}
+
+StringResponse MakeAdminResponse(std::string_view target, http::verb method, unsigned http_version, bool keep_alive) {
+    if (method != http::verb::get) {
+        return MakeStringResponse(http::status::method_not_allowed, "Only GET is allowed"sv,
+                                  http_version, keep_alive, ContentType::TEXT_PLAIN, true);
+    }
+    if (target == REQUEST_METRICS) {
+        return MakeStringResponse(http::status::ok, metrics::Registry::Instance().Serialize(),
+                                  http_version, keep_alive, ContentType::PROMETHEUS_TEXT, true);
+    }
+    if (target == REQUEST_TRACE) {
+        return MakeTraceResponse(http_version, keep_alive);
+    }
+    return MakeStringResponse(http::status::not_found, "Unknown admin route"sv,
+                              http_version, keep_alive, ContentType::TEXT_PLAIN, true);
+}
+
 } // namespace http_handler
@@ -9,6 +9,8 @@
 #include "common_handler.h"
 #include <iostream>
 #include "log.h"
+#include "metrics.h"
+#include "trace.h"
 
 namespace net = boost::asio;
 
@@ -23,6 +25,39 @@ namespace fs = std::filesystem;
 
 std::string FromUrlEncoding(const std::string& str);
 
+inline constexpr std::string_view REQUEST_METRICS = "/metrics"sv;
+inline constexpr std::string_view REQUEST_TRACE = "/debug/trace"sv;
+
+// Отрезки трассировки в формате Chrome trace event JSON (404, если трассировка не собрана)
+StringResponse MakeTraceResponse(unsigned http_version, bool keep_alive);
+
+// Ответ служебного маршрута: /metrics, /debug/trace или 404
+StringResponse MakeAdminResponse(std::string_view target, http::verb method, unsigned http_version, bool keep_alive);
+
+// Служебные маршруты без авторизации. Обслуживаются отдельным слушателем
+// на loopback-адресе (--admin-port) в своем потоке, а не игровым портом
+class AdminRequestHandler {
+public:
+    template <typename Body, typename Allocator, typename Send>
+    void operator()(http::request<Body, http::basic_fields<Allocator>>&& req,
+                    [[maybe_unused]] const net::ip::tcp::endpoint& remote_endpoint, Send&& send) {
+        const auto start_time = std::chrono::high_resolution_clock::now();
+        
+        StringResponse res = MakeAdminResponse(req.target(), req.method(), req.version(), req.keep_alive());
+        
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start_time);
+        boost::json::value log_json_resp = {
+            {"response_time", duration.count()},
+            {"code", res.result_int()},
+            {"content_type", std::string(res[http::field::content_type])}
+        };
+        BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json_resp) << "response sent";
+        
+        send(std::move(res));
+    }
+};
+
 class RequestHandler : public std::enable_shared_from_this<RequestHandler> {
 public:
     using Strand = net::strand<net::io_context::executor_type>;
@@ -42,8 +77,21 @@ public:
         try {
                     if (url.starts_with("/api/")) {
                         
+                        const bool on_strand = api_handler::NeedsApiStrand(url, game_);
+                        
                         auto handle = [self = shared_from_this(), send,
-                                       req = std::forward<decltype(req)>(req), this, url, start_time] {
+                                       req = std::forward<decltype(req)>(req), this, url, start_time,
+                                       on_strand, queued = metrics::Clock::now()] {
+                            
+                            // сколько запрос ждал своей очереди в strand игры
+                            if (on_strand) {
+                                static auto& strand_delay = metrics::Registry::Instance().GetHistogram(
+                                    "api_strand_queue_delay_seconds",
+                                    "Time an API request waits in the game strand queue");
+                                const auto delay = metrics::Clock::now() - queued;
+                                strand_delay.Observe(delay);
+                                TRACE_COMPLETE("api.strand_wait"sv, queued, delay);
+                            }
                             
                             StringResponse res = api_handler::ProcessApi(std::move(req), game_, url, start_time);
                             
@@ -62,7 +110,11 @@ public:
                             send(res);
                         };
                         
-                        net::dispatch(api_strand_, handle);
+                        if (on_strand) {
+                            net::dispatch(api_strand_, handle);
+                        } else {
+                            handle();
+                        }
                         
                     } else {
                         VariantResponse response_var = file_handler::ProcessFile(std::move(req), url, base_path_);
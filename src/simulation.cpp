@@ -0,0 +1,174 @@
+#include "simulation.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <stdexcept>
+
+#include "application.h"
+#include "metrics.h"
+
+namespace simulation {
+
+namespace {
+
+using namespace std::literals;
+
+constexpr std::array<std::string_view, 4> PATROL_ROUTE{"R", "D", "L", "U"};
+constexpr std::array<std::string_view, 5> RANDOM_MOVES{"L", "R", "U", "D", ""};
+
+// Фазы тика сессии, как они подписаны в game_tick_phase_duration_seconds
+constexpr std::array<std::string_view, 5> TICK_PHASES{"movement", "gathering", "loot_spawn", "retirement", "snapshot"};
+
+struct MemoryUsage {
+    std::uint64_t rss_kb = 0;
+    std::uint64_t peak_kb = 0;
+};
+
+// Текущий и пиковый размер резидентной памяти процесса (Linux)
+MemoryUsage ReadMemoryUsage() {
+    MemoryUsage usage;
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        // строки вида "VmRSS:     12345 kB"
+        const auto read_kb = [&line](std::string_view key, std::uint64_t& value) {
+            if (line.starts_with(key)) {
+                value = std::stoull(line.substr(key.size()));
+            }
+        };
+        read_kb("VmRSS:"sv, usage.rss_kb);
+        read_kb("VmHWM:"sv, usage.peak_kb);
+    }
+    return usage;
+}
+
+double ToMiB(std::uint64_t kb) {
+    return static_cast<double>(kb) / 1024.0;
+}
+
+} // namespace
+
+MovePolicy ParseMovePolicy(const std::string& policy) {
+    if (policy == "random"sv) {
+        return MovePolicy::RANDOM;
+    }
+    if (policy == "patrol"sv) {
+        return MovePolicy::PATROL;
+    }
+    throw std::runtime_error("ERROR:Unknown simulation move policy: "s + policy);
+}
+
+void Run(model::Game& game, const Settings& settings, std::ostream& out) {
+    std::vector<std::string> maps = settings.maps;
+    if (maps.empty()) {
+        for (const auto& map : game.GetMaps()) {
+            maps.push_back(*map->GetId());
+        }
+    }
+    if (maps.empty()) {
+        throw std::runtime_error("ERROR:No maps to simulate"s);
+    }
+
+    const auto memory_before = ReadMemoryUsage();
+
+    // игроки входят тем же путем, что и через /game/join
+    std::vector<PlayerShared> players;
+    players.reserve(settings.dogs);
+    for (unsigned i = 0; i < settings.dogs; ++i) {
+        const auto& map_id = maps[i % maps.size()];
+        auto player = Players::AddPlayer(game, "sim"s + std::to_string(i), map_id);
+        if (!player) {
+            throw std::runtime_error("ERROR:Map "s + map_id + " not found");
+        }
+        players.push_back(std::move(player));
+    }
+
+    const auto memory_joined = ReadMemoryUsage();
+
+    // зерна тиков и команды берутся из одного генератора, поэтому прогон повторяем
+    std::mt19937_64 random(settings.seed);
+    std::bernoulli_distribution turn(settings.turn_probability);
+    std::uniform_int_distribution<std::size_t> pick_move(0, RANDOM_MOVES.size() - 1);
+
+    // команды ставятся в очередь сессии и применяются в начале тика, как команды HTTP
+    const auto issue_moves = [&](unsigned tick) {
+        for (std::size_t i = 0; i < players.size(); ++i) {
+            std::string_view move;
+            if (settings.policy == MovePolicy::PATROL) {
+                if ((tick + i) % settings.patrol_ticks != 0) {
+                    continue;
+                }
+                move = PATROL_ROUTE[(tick / settings.patrol_ticks + i) % PATROL_ROUTE.size()];
+            } else {
+                if (tick != 0 && !turn(random)) {
+                    continue;
+                }
+                move = RANDOM_MOVES[pick_move(random)];
+            }
+            players[i]->GetSession()->EnqueueAction({players[i]->GetDog(), std::string(move)});
+        }
+    };
+
+    std::vector<double> tick_times;
+    tick_times.reserve(settings.ticks);
+
+    const auto start = metrics::Clock::now();
+    for (unsigned tick = 0; tick < settings.ticks; ++tick) {
+        issue_moves(tick);
+
+        metrics::Stopwatch stopwatch;
+        game.UpdateTickState(static_cast<int>(settings.tick.count()), random());
+        tick_times.push_back(std::chrono::duration<double>(stopwatch.Lap()).count());
+    }
+    const std::chrono::duration<double> elapsed = metrics::Clock::now() - start;
+
+    const auto memory_after = ReadMemoryUsage();
+    auto& registry = metrics::Registry::Instance();
+    const double dogs_left = registry.GetGauge("game_dogs", "").Value();
+    const double loots_left = registry.GetGauge("game_loots", "").Value();
+
+    std::sort(tick_times.begin(), tick_times.end());
+    double total_tick_time = 0;
+    for (double time : tick_times) {
+        total_tick_time += time;
+    }
+
+    out << std::fixed << std::setprecision(0);
+    out << "dogs: " << settings.dogs << " on " << maps.size() << " maps in "
+        << game.GetSessionsCount() << " sessions, "
+        << dogs_left << " left, loot on maps: " << loots_left << '\n';
+    out << "ticks: " << settings.ticks << " x " << settings.tick.count() << " ms in "
+        << std::setprecision(2) << elapsed.count() << " s, "
+        << std::setprecision(1) << static_cast<double>(settings.ticks) / elapsed.count() << " ticks/s, "
+        << static_cast<double>(settings.ticks) * settings.tick.count() / 1000.0 / elapsed.count()
+        << "x real time\n";
+
+    out << std::setprecision(3);
+    if (!tick_times.empty()) {
+        out << "tick, ms: mean " << total_tick_time / tick_times.size() * 1000
+            << ", p50 " << metrics::Percentile(tick_times, 0.5) * 1000
+            << ", p99 " << metrics::Percentile(tick_times, 0.99) * 1000
+            << ", max " << tick_times.back() * 1000 << '\n';
+    }
+
+    // фазы суммируются по всем сессиям тика
+    out << "phases, ms per tick:";
+    for (auto phase : TICK_PHASES) {
+        const auto sum = registry.GetHistogram("game_tick_phase_duration_seconds", "",
+                                               metrics::Labels({{"phase", phase}})).Sum();
+        const double per_tick = std::chrono::duration<double, std::milli>(sum).count() / std::max(1u, settings.ticks);
+        out << ' ' << phase << ' ' << per_tick;
+    }
+    out << '\n';
+
+    out << std::setprecision(1);
+    out << "memory, MiB: before join " << ToMiB(memory_before.rss_kb)
+        << ", after join " << ToMiB(memory_joined.rss_kb)
+        << ", after run " << ToMiB(memory_after.rss_kb)
+        << ", peak " << ToMiB(memory_after.peak_kb) << std::endl;
+}
+
+}  // namespace simulation
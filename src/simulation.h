@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "model.h"
+
+namespace simulation {
+
+/*
+ *  Безголовый прогон игры для оценки производительности (game_server --simulate).
+ *  В игру входят синтетические игроки, тики идут подряд без HTTP, БД и таймера
+ *  с фиксированным виртуальным шагом. По итогам печатаются тики в секунду,
+ *  время тика и его фаз и потребление памяти.
+ */
+
+enum class MovePolicy {
+    RANDOM,  // в каждом тике собака с вероятностью turn_probability меняет направление
+    PATROL   // собаки по очереди обходят R, D, L, U, меняя направление раз в patrol_ticks
+};
+
+struct Settings {
+    unsigned dogs = 1000;
+    unsigned ticks = 1000;
+    std::chrono::milliseconds tick{50};  // виртуальный шаг, передаваемый в UpdateTickState
+    MovePolicy policy = MovePolicy::RANDOM;
+    double turn_probability = 0.05;
+    unsigned patrol_ticks = 20;
+    std::vector<std::string> maps;  // пусто - собаки распределяются по всем картам
+    std::uint64_t seed = 42;
+};
+
+MovePolicy ParseMovePolicy(const std::string& policy);
+
+// Запускает прогон на загруженной игре и пишет отчет в out
+void Run(model::Game& game, const Settings& settings, std::ostream& out);
+
+}  // namespace simulation
@@ -0,0 +1,339 @@
+#include "state_format.h"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace serialization {
+
+static_assert(std::endian::native == std::endian::little, "State file format is little-endian");
+
+namespace {
+
+using codec::SectionEntry;
+using codec::StringRef;
+
+constexpr codec::Magic MAGIC = {'G', 'S', 'S', 'T', 'A', 'T', 'E', '\0'};
+constexpr std::string_view FORMAT = "state file";
+
+enum class Section : std::uint32_t {
+    LOOTS,
+    DOGS,
+    SESSIONS,
+    PLAYERS,
+    IDS,
+    STRINGS,
+    META,       // с версии 2
+    COUNT
+};
+
+constexpr std::size_t SECTION_COUNT = static_cast<std::size_t>(Section::COUNT);
+
+// Число секций в файлах каждой версии формата
+constexpr std::array<std::size_t, STATE_FORMAT_VERSION + 1> VERSION_SECTION_COUNT = {0, 6, 7, 7};
+
+// Диапазон в общем массиве id
+struct IdRange {
+    std::uint32_t begin;
+    std::uint32_t count;
+};
+
+struct LootRecord {
+    std::int32_t id;
+    std::int32_t type;
+    double x;
+    double y;
+};
+
+struct DogRecord {
+    std::int32_t id;
+    std::int32_t direction;
+    double x;
+    double y;
+    double speed_x;
+    double speed_y;
+    double map_speed;
+    std::int32_t bag_capacity;
+    std::int32_t score;
+    std::int32_t full_time;
+    std::int32_t retire_time;
+    StringRef name;
+    IdRange bag;
+};
+
+struct SessionRecord {
+    std::int32_t id;
+    std::uint32_t reserved;
+    StringRef map_id;
+    IdRange loots;
+    IdRange dogs;
+};
+
+struct PlayerRecord {
+    std::uint64_t id;
+    std::int32_t dog_id;
+    std::int32_t session_id;
+    StringRef token;
+};
+
+// Состояние, не привязанное к объектам модели (одна запись)
+struct MetaRecord {
+    std::uint64_t journal_segment;
+    std::int64_t loot_time_without_loot;  // мс
+    // с версии 3: следующие id лута и сессий
+    std::int32_t next_loot_id;
+    std::int32_t next_session_id;
+};
+
+// Размер записи META в файлах версии 2, до счетчиков id
+constexpr std::size_t META_V2_SIZE = offsetof(MetaRecord, next_loot_id);
+
+static_assert(std::is_trivially_copyable_v<LootRecord> && std::is_trivially_copyable_v<DogRecord>
+              && std::is_trivially_copyable_v<SessionRecord> && std::is_trivially_copyable_v<PlayerRecord>
+              && std::is_trivially_copyable_v<MetaRecord>);
+
+constexpr std::array<std::size_t, SECTION_COUNT> RECORD_SIZES = {
+    sizeof(LootRecord), sizeof(DogRecord), sizeof(SessionRecord),
+    sizeof(PlayerRecord), sizeof(std::int32_t), 1, sizeof(MetaRecord)
+};
+
+using Reader = codec::SectionReader<Section, SECTION_COUNT>;
+
+std::vector<int> GetIds(const Reader& reader, IdRange range) {
+    const std::string_view bytes = reader.GetRecords(Section::IDS, range.begin, range.count);
+    std::vector<int> ids(range.count);
+    if (!ids.empty()) {
+        std::memcpy(ids.data(), bytes.data(), bytes.size());
+    }
+    return ids;
+}
+
+} // namespace
+
+bool BinaryStateFormat::IsBinary(std::string_view data) noexcept {
+    return codec::HasMagic(data, MAGIC);
+}
+
+std::string BinaryStateFormat::Encode(const GameStateRepr& state) {
+    static_assert(sizeof(int) == sizeof(std::int32_t));
+
+    // размеры массива id и блока строк известны заранее, поэтому
+    // все секции размечаются до записи и буфер выделяется один раз
+    std::size_t ids_count = 0;
+    std::size_t strings_size = 0;
+    for (const auto& dog : state.dogs) {
+        ids_count += dog.id_loots_in_bag_.size();
+        strings_size += dog.name_.size();
+    }
+    for (const auto& session : state.sessions) {
+        ids_count += session.id_loots_.size() + session.id_dogs_.size();
+        strings_size += session.id_map_.size();
+    }
+    for (const auto& player : state.players) {
+        strings_size += player.token_.size();
+    }
+
+    std::array<SectionEntry, SECTION_COUNT> sections{};
+    const auto layout = [&sections](Section kind, std::size_t count, std::size_t offset) {
+        return codec::LayoutSection(sections, kind, RECORD_SIZES[static_cast<std::size_t>(kind)], count, offset);
+    };
+
+    std::size_t offset = codec::FirstSectionOffset(SECTION_COUNT);
+    offset = layout(Section::LOOTS, state.loots.size(), offset);
+    offset = layout(Section::DOGS, state.dogs.size(), offset);
+    offset = layout(Section::SESSIONS, state.sessions.size(), offset);
+    offset = layout(Section::PLAYERS, state.players.size(), offset);
+    offset = layout(Section::IDS, ids_count, offset);
+    offset = layout(Section::STRINGS, strings_size, offset);
+    offset = layout(Section::META, 1, offset);
+
+    if (strings_size > UINT32_MAX || ids_count > UINT32_MAX) {
+        throw std::runtime_error("State is too large for the state file format");
+    }
+
+    std::string buffer(offset, '\0');
+
+    std::size_t next_id = 0;
+    std::size_t next_string = 0;
+    const auto& ids_section = sections[static_cast<std::size_t>(Section::IDS)];
+    const auto& strings_section = sections[static_cast<std::size_t>(Section::STRINGS)];
+
+    const auto put_ids = [&](const std::vector<int>& ids) {
+        IdRange range{static_cast<std::uint32_t>(next_id), static_cast<std::uint32_t>(ids.size())};
+        codec::PutBytesAt(buffer, ids_section.offset + next_id * sizeof(std::int32_t),
+                          std::string_view(reinterpret_cast<const char*>(ids.data()), ids.size() * sizeof(std::int32_t)));
+        next_id += ids.size();
+        return range;
+    };
+    const auto put_string = [&](const std::string& str) {
+        StringRef ref{static_cast<std::uint32_t>(next_string), static_cast<std::uint32_t>(str.size())};
+        codec::PutBytesAt(buffer, strings_section.offset + next_string, str);
+        next_string += str.size();
+        return ref;
+    };
+
+    const auto put = [&buffer, &sections](Section kind, std::size_t index, const auto& record) {
+        codec::PutAt(buffer, codec::RecordOffset(sections, kind, index), record);
+    };
+
+    for (std::size_t i = 0; i < state.loots.size(); ++i) {
+        const auto& loot = state.loots[i];
+        put(Section::LOOTS, i, LootRecord{loot.id_, loot.loot_type_, loot.position_.x, loot.position_.y});
+    }
+
+    for (std::size_t i = 0; i < state.dogs.size(); ++i) {
+        const auto& dog = state.dogs[i];
+        DogRecord record{};
+        record.id = dog.id_;
+        record.direction = static_cast<std::int32_t>(dog.direction_);
+        record.x = dog.cords_.x;
+        record.y = dog.cords_.y;
+        record.speed_x = dog.speed_.x;
+        record.speed_y = dog.speed_.y;
+        record.map_speed = dog.map_speed_;
+        record.bag_capacity = dog.bag_capacity_;
+        record.score = dog.score_;
+        record.full_time = dog.full_time_;
+        record.retire_time = dog.retire_time_;
+        record.name = put_string(dog.name_);
+        record.bag = put_ids(dog.id_loots_in_bag_);
+        put(Section::DOGS, i, record);
+    }
+
+    for (std::size_t i = 0; i < state.sessions.size(); ++i) {
+        const auto& session = state.sessions[i];
+        SessionRecord record{};
+        record.id = session.id_;
+        record.map_id = put_string(session.id_map_);
+        record.loots = put_ids(session.id_loots_);
+        record.dogs = put_ids(session.id_dogs_);
+        put(Section::SESSIONS, i, record);
+    }
+
+    for (std::size_t i = 0; i < state.players.size(); ++i) {
+        const auto& player = state.players[i];
+        PlayerRecord record{};
+        record.id = player.id_;
+        record.dog_id = player.dog_id_;
+        record.session_id = player.session_id_;
+        record.token = put_string(player.token_);
+        put(Section::PLAYERS, i, record);
+    }
+
+    put(Section::META, 0, MetaRecord{state.journal_segment, state.loot_time_without_loot,
+                                     state.next_loot_id, state.next_session_id});
+
+    codec::WriteFileHeader(buffer, MAGIC, STATE_FORMAT_VERSION, sections);
+
+    return buffer;
+}
+
+GameStateRepr BinaryStateFormat::Decode(std::string_view data) {
+    const auto header = codec::ReadFileHeader(data, MAGIC, FORMAT);
+
+    if (header.version == 0 || header.version > STATE_FORMAT_VERSION) {
+        throw std::runtime_error("Unsupported state file version " + std::to_string(header.version));
+    }
+
+    auto record_sizes = RECORD_SIZES;
+    if (header.version < 3) {
+        record_sizes[static_cast<std::size_t>(Section::META)] = META_V2_SIZE;
+    }
+
+    // секции, которых нет в старой версии файла, остаются пустыми
+    const auto sections = codec::ReadSectionTable(data, header, VERSION_SECTION_COUNT[header.version],
+                                                  record_sizes, FORMAT);
+
+    Reader reader(data, sections, FORMAT);
+    GameStateRepr state;
+
+    state.loots.resize(reader.Count(Section::LOOTS));
+    for (std::size_t i = 0; i < state.loots.size(); ++i) {
+        const auto record = reader.Get<LootRecord>(Section::LOOTS, i);
+        auto& loot = state.loots[i];
+        loot.id_ = record.id;
+        loot.loot_type_ = record.type;
+        loot.position_ = {record.x, record.y};
+    }
+
+    state.dogs.resize(reader.Count(Section::DOGS));
+    for (std::size_t i = 0; i < state.dogs.size(); ++i) {
+        const auto record = reader.Get<DogRecord>(Section::DOGS, i);
+        auto& dog = state.dogs[i];
+        dog.id_ = record.id;
+        dog.name_ = std::string(reader.GetString(record.name));
+        dog.cords_ = {record.x, record.y};
+        dog.speed_ = {record.speed_x, record.speed_y};
+        dog.direction_ = static_cast<model::Direction>(record.direction);
+        dog.map_speed_ = record.map_speed;
+        dog.bag_capacity_ = record.bag_capacity;
+        dog.score_ = record.score;
+        dog.id_loots_in_bag_ = GetIds(reader, record.bag);
+        dog.full_time_ = record.full_time;
+        dog.retire_time_ = record.retire_time;
+    }
+
+    state.sessions.resize(reader.Count(Section::SESSIONS));
+    for (std::size_t i = 0; i < state.sessions.size(); ++i) {
+        const auto record = reader.Get<SessionRecord>(Section::SESSIONS, i);
+        auto& session = state.sessions[i];
+        session.id_ = record.id;
+        session.id_map_ = std::string(reader.GetString(record.map_id));
+        session.id_loots_ = GetIds(reader, record.loots);
+        session.id_dogs_ = GetIds(reader, record.dogs);
+    }
+
+    state.players.resize(reader.Count(Section::PLAYERS));
+    for (std::size_t i = 0; i < state.players.size(); ++i) {
+        const auto record = reader.Get<PlayerRecord>(Section::PLAYERS, i);
+        auto& player = state.players[i];
+        player.id_ = record.id;
+        player.token_ = std::string(reader.GetString(record.token));
+        player.dog_id_ = record.dog_id;
+        player.session_id_ = record.session_id;
+    }
+
+    if (reader.Count(Section::META) > 0) {
+        // в записи версии 2 нет счетчиков id, они остаются нулевыми
+        MetaRecord meta{};
+        const auto bytes = reader.GetRecords(Section::META, 0, 1);
+        std::memcpy(&meta, bytes.data(), bytes.size());
+        state.journal_segment = meta.journal_segment;
+        state.loot_time_without_loot = meta.loot_time_without_loot;
+        state.next_loot_id = meta.next_loot_id;
+        state.next_session_id = meta.next_session_id;
+    }
+
+    return state;
+}
+
+GameStateRepr ReadState(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Cannot open file for loading state");
+    }
+
+    std::string data(static_cast<std::size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    if (!file.read(data.data(), static_cast<std::streamsize>(data.size()))) {
+        throw std::runtime_error("Cannot read state file");
+    }
+
+    if (BinaryStateFormat::IsBinary(data)) {
+        return BinaryStateFormat::Decode(data);
+    }
+
+    // сохранение в старом текстовом формате
+    GameStateRepr state;
+    std::istringstream text(std::move(data));
+    boost::archive::text_iarchive ia(text);
+    state.Read(ia);
+    return state;
+}
+
+}  // namespace serialization
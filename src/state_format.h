@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "byte_codec.h"
+#include "model_serialization.h"
+
+namespace serialization {
+
+/*
+ *  Двоичный формат файла состояния.
+ *
+ *  Заголовок: сигнатура, версия формата, число секций, размер файла
+ *  и контрольная сумма всего, что идет после заголовка. За ним - таблица секций
+ *  (тип, размер записи, смещение, размер и число записей). Секции - плоские массивы
+ *  записей фиксированного размера: лут, собаки, сессии, игроки, общий массив id
+ *  (содержимое рюкзаков и сессий), блок строк и, с версии 2, запись с номером
+ *  сегмента журнала и состоянием генератора лута (с версии 3 - и со счетчиками id
+ *  лута и сессий). Секции выровнены по 8 байт, числа хранятся в little-endian,
+ *  поэтому файл читается одним чтением или отображается в память.
+ */
+inline constexpr std::uint32_t STATE_FORMAT_VERSION = 3;
+
+class BinaryStateFormat {
+public:
+    BinaryStateFormat() = delete;
+
+    // Кодирует состояние в буфер за один проход
+    static std::string Encode(const GameStateRepr& state);
+
+    // Проверяет сигнатуру, версию и контрольную сумму и восстанавливает состояние.
+    // Выбрасывает std::runtime_error, если файл поврежден
+    static GameStateRepr Decode(std::string_view data);
+
+    // Начинаются ли данные с сигнатуры двоичного формата
+    static bool IsBinary(std::string_view data) noexcept;
+};
+
+// Читает файл состояния одним чтением. Сохранения старого текстового формата
+// (Boost text archive) читаются через Boost.Serialization, а при следующем
+// сохранении записываются уже в двоичном формате
+GameStateRepr ReadState(const std::string& path);
+
+}  // namespace serialization
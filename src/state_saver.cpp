@@ -0,0 +1,196 @@
+#include "state_saver.h"
+
+#include <filesystem>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "metrics.h"
+#include "trace.h"
+#include "state_format.h"
+
+namespace serialization {
+
+namespace {
+
+metrics::Counter& SkippedSaves() {
+    static auto& counter = metrics::Registry::Instance().GetCounter(
+        "state_saves_skipped_total", "State saves skipped because the previous save was still running");
+    return counter;
+}
+
+metrics::Histogram& SaveDuration() {
+    static auto& histogram = metrics::Registry::Instance().GetHistogram(
+        "state_save_duration_seconds", "Time to encode, write and fsync a state file");
+    return histogram;
+}
+
+// Закрывает файловый дескриптор при выходе из области видимости
+class FileDescriptor {
+public:
+    explicit FileDescriptor(int fd) : fd_(fd) {}
+
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+    ~FileDescriptor() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    int Get() const noexcept {
+        return fd_;
+    }
+
+private:
+    int fd_;
+};
+
+[[noreturn]] void ThrowSystemError(const std::string& what) {
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+void WriteAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = ::write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("Cannot write state file");
+        }
+        data.remove_prefix(static_cast<std::size_t>(written));
+    }
+}
+
+} // namespace
+
+std::uint64_t WriteState(const GameStateRepr& state, const std::string& path) {
+    namespace fs = std::filesystem;
+
+    const std::string data = BinaryStateFormat::Encode(state);
+
+    fs::path temp_path(path);
+    temp_path += ".tmp";
+
+    {
+        FileDescriptor file(::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+        if (file.Get() < 0) {
+            ThrowSystemError("Cannot open file for saving state");
+        }
+        WriteAll(file.Get(), data);
+        if (::fsync(file.Get()) != 0) {
+            ThrowSystemError("Cannot flush state file");
+        }
+    }
+
+    fs::rename(temp_path, fs::path(path));
+
+    // переименование становится надежным только после fsync каталога
+    fs::path directory = fs::absolute(fs::path(path)).parent_path();
+    FileDescriptor dir(::open(directory.c_str(), O_RDONLY | O_DIRECTORY));
+    if (dir.Get() >= 0) {
+        ::fsync(dir.Get());
+    }
+
+    return data.size();
+}
+
+StateSaver::StateSaver(std::string path)
+    : path_(std::move(path))
+    , worker_([this](std::stop_token stop) { Run(stop); }) {
+}
+
+StateSaver::~StateSaver() {
+    Wait();
+}
+
+bool StateSaver::SaveAsync(GameStateRepr&& state) {
+    {
+        std::lock_guard lock{mutex_};
+        if (busy_) {
+            SkippedSaves().Add();
+            return false;
+        }
+        busy_ = true;
+        pending_ = std::move(state);
+    }
+    cond_var_.notify_all();
+    return true;
+}
+
+bool StateSaver::SkipIfBusy() {
+    std::lock_guard lock{mutex_};
+    if (busy_) {
+        SkippedSaves().Add();
+    }
+    return busy_;
+}
+
+void StateSaver::Save(const GameStateRepr& state) {
+    static auto& bytes = metrics::Registry::Instance().GetGauge(
+        "state_save_bytes", "Size of the last saved state file");
+
+    Wait();
+
+    {
+        TRACE_SPAN("state.write");
+        metrics::ScopedTimer timer{SaveDuration()};
+        bytes.Set(static_cast<double>(WriteState(state, path_)));
+    }
+    if (on_saved_) {
+        on_saved_(state);
+    }
+}
+
+void StateSaver::Wait() {
+    std::unique_lock lock{mutex_};
+    cond_var_.wait(lock, [this] { return !busy_; });
+}
+
+void StateSaver::Run(std::stop_token stop) {
+    static auto& bytes = metrics::Registry::Instance().GetGauge(
+        "state_save_bytes", "Size of the last saved state file");
+    static auto& failures = metrics::Registry::Instance().GetCounter(
+        "state_save_failures_total", "Background state saves that failed");
+
+    for (;;) {
+        std::optional<GameStateRepr> state;
+        {
+            std::unique_lock lock{mutex_};
+            if (!cond_var_.wait(lock, stop, [this] { return pending_.has_value(); })) {
+                return;
+            }
+            state = std::move(pending_);
+            pending_.reset();
+        }
+
+        try {
+            {
+                TRACE_SPAN("state.write");
+                metrics::ScopedTimer timer{SaveDuration()};
+                bytes.Set(static_cast<double>(WriteState(*state, path_)));
+            }
+            if (on_saved_) {
+                on_saved_(*state);
+            }
+        } catch (const std::exception& e) {
+            failures.Add();
+            boost::json::value log_json = {{"text", e.what()}, {"where", "save_state"}};
+            BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, log_json) << "error";
+        }
+
+        {
+            std::lock_guard lock{mutex_};
+            busy_ = false;
+        }
+        cond_var_.notify_all();
+    }
+}
+
+}  // namespace serialization
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "model_serialization.h"
+
+namespace serialization {
+
+/*
+ *  Сохраняет копии состояния игры в фоновом потоке. Копия снимается в strand игры
+ *  (CaptureState), а кодирование, запись, fsync и переименование файла выполняются
+ *  здесь. Одновременно выполняется не больше одного сохранения.
+ */
+class StateSaver {
+public:
+    explicit StateSaver(std::string path);
+
+    StateSaver(const StateSaver&) = delete;
+    StateSaver& operator=(const StateSaver&) = delete;
+
+    // Дожидается завершения текущего сохранения
+    ~StateSaver();
+
+    // Передает копию состояния фоновому потоку. Возвращает false, если
+    // предыдущее сохранение еще не завершено - тогда копия отбрасывается
+    bool SaveAsync(GameStateRepr&& state);
+
+    // Возвращает true и учитывает пропуск, если предыдущее сохранение еще идет.
+    // Проверяется до снятия копии, чтобы пропущенный период не копировал состояние
+    bool SkipIfBusy();
+
+    // Сохраняет состояние в вызывающем потоке, дождавшись фонового сохранения
+    void Save(const GameStateRepr& state);
+
+    // Ожидает завершения фонового сохранения
+    void Wait();
+    
+    // Вызывается после успешной записи файла (в потоке, который его записал).
+    // Задается до первого сохранения
+    void SetOnSaved(std::function<void(const GameStateRepr&)> on_saved) {
+        on_saved_ = std::move(on_saved);
+    }
+
+private:
+    void Run(std::stop_token stop);
+
+    std::string path_;
+    std::function<void(const GameStateRepr&)> on_saved_;
+
+    std::mutex mutex_;
+    std::condition_variable_any cond_var_;
+    std::optional<GameStateRepr> pending_;
+    bool busy_ = false;
+
+    std::jthread worker_;
+};
+
+// Записывает состояние во временный файл, сбрасывает его на диск и атомарно
+// переименовывает в path. Возвращает размер записанных данных
+std::uint64_t WriteState(const GameStateRepr& state, const std::string& path);
+
+}  // namespace serialization
@@ -0,0 +1,45 @@
+#include "tick_arena.h"
+
+#include "metrics.h"
+
+namespace model {
+
+TickArena::TickArena(std::size_t initial_size)
+    : size_(initial_size)
+    , buffer_(std::make_unique<std::byte[]>(initial_size)) {
+    resource_.emplace(buffer_.get(), size_, &overflow_);
+}
+
+void TickArena::Reset() {
+    static auto& capacity = metrics::Registry::Instance().GetGauge(
+        "game_tick_arena_bytes", "Size of the scratch buffer for tick temporaries");
+    static auto& overflows = metrics::Registry::Instance().GetCounter(
+        "game_tick_arena_overflows_total", "Ticks whose temporaries did not fit into the scratch buffer");
+
+    const std::size_t overflow = overflow_.Allocated();
+
+    // память сверх буфера возвращается в кучу вместе с ресурсом
+    resource_.reset();
+    overflow_.Clear();
+
+    if (overflow > 0) {
+        overflows.Add();
+        // с запасом, чтобы не расти понемногу каждый тик
+        size_ = (size_ + overflow) * 2;
+        buffer_ = std::make_unique<std::byte[]>(size_);
+    }
+    capacity.Set(static_cast<double>(size_));
+
+    resource_.emplace(buffer_.get(), size_, &overflow_);
+}
+
+void* TickArena::Overflow::do_allocate(std::size_t bytes, std::size_t alignment) {
+    allocated_ += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void TickArena::Overflow::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+}
+
+}  // namespace model
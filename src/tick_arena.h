@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+namespace model {
+
+/*
+ *  Память для временных объектов тика (очереди команд, списки для поиска
+ *  столкновений, маршруты собак). Выделяется подряд из буфера и освобождается
+ *  вся сразу в Reset в начале следующего тика. Если тику не хватило буфера,
+ *  остаток берется из кучи, а при сбросе буфер увеличивается, поэтому
+ *  в установившемся режиме тик не обращается к куче.
+ */
+class TickArena {
+public:
+    explicit TickArena(std::size_t initial_size = 64 * 1024);
+
+    TickArena(const TickArena&) = delete;
+    TickArena& operator=(const TickArena&) = delete;
+
+    // Ресурс действителен до следующего Reset
+    std::pmr::memory_resource* Resource() noexcept {
+        return &*resource_;
+    }
+
+    // Освобождает все выделенное с прошлого сброса
+    void Reset();
+
+    std::size_t Capacity() const noexcept {
+        return size_;
+    }
+
+private:
+    // Память сверх буфера: считает, сколько ее понадобилось за тик
+    class Overflow : public std::pmr::memory_resource {
+    public:
+        std::size_t Allocated() const noexcept {
+            return allocated_;
+        }
+
+        void Clear() noexcept {
+            allocated_ = 0;
+        }
+
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+        std::size_t allocated_ = 0;
+    };
+
+    std::size_t size_;
+    std::unique_ptr<std::byte[]> buffer_;
+    Overflow overflow_;
+    std::optional<std::pmr::monotonic_buffer_resource> resource_;
+};
+
+}  // namespace model
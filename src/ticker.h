@@ -2,57 +2,123 @@
 
 #include "sdk.h"
 #include <chrono>
+#include <stdexcept>
+#include <string>
+#include <algorithm>
 #include <boost/asio/strand.hpp>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/steady_timer.hpp>
 
+#include "metrics.h"
+
+// Что делать, если тик опоздал больше чем на период
+enum class TickCatchUpPolicy {
+    SKIP,       // пропущенные тики отбрасываются, вызов с одним периодом
+    COALESCE,   // один вызов с суммарным временем всех пропущенных тиков
+    SUBSTEPS    // по вызову с периодом на каждый пропущенный тик, но не больше max_substeps
+};
+
+struct TickerSettings {
+    TickCatchUpPolicy policy = TickCatchUpPolicy::COALESCE;
+    int max_substeps = 4;
+    std::string name = "game";  // метка ticker в метриках
+};
+
 class Ticker : public std::enable_shared_from_this<Ticker> {
 public:
     using Strand = net::strand<net::io_context::executor_type>;
     using Handler = std::function<void(std::chrono::milliseconds delta)>;
 
-    // Функция handler будет вызываться внутри strand с интервалом period
-    Ticker(Strand strand, std::chrono::milliseconds period, Handler handler)
+    using CatchUpPolicy = TickCatchUpPolicy;
+    using Settings = TickerSettings;
+
+    // Функция handler будет вызываться внутри strand с интервалом period.
+    // Тики планируются по абсолютным срокам (start + n * period), поэтому время
+    // работы handler не сдвигает расписание
+    Ticker(Strand strand, std::chrono::milliseconds period, Handler handler, Settings settings = {})
         : strand_{strand}
         , period_{period}
-        , handler_{std::move(handler)} {
+        , handler_{std::move(handler)}
+        , settings_{std::move(settings)}
+        , overruns_{metrics::Registry::Instance().GetCounter(
+              "ticker_overruns_total", "Ticks missed because the previous tick finished too late",
+              metrics::Labels({{"ticker", settings_.name}}))}
+        , lateness_{metrics::Registry::Instance().GetHistogram(
+              "ticker_lateness_seconds", "Delay between a tick deadline and the actual tick",
+              metrics::Labels({{"ticker", settings_.name}}))} {
+        // число пропущенных сроков считается делением на period
+        if (period_ <= std::chrono::milliseconds::zero()) {
+            throw std::invalid_argument("Tick period must be positive");
+        }
     }
 
     void Start() {
         net::dispatch(strand_, [self = shared_from_this()] {
-            self->last_tick_ = Clock::now();
+            self->next_deadline_ = Clock::now() + self->period_;
             self->ScheduleTick();
         });
     }
 
+    std::uint64_t GetOverruns() const noexcept {
+        return overruns_.Value();
+    }
+
 private:
+    using Clock = std::chrono::steady_clock;
+
     void ScheduleTick() {
-        timer_.expires_after(period_);
+        timer_.expires_at(next_deadline_);
         timer_.async_wait([self = shared_from_this()](sys::error_code ec) {
             self->OnTick(ec);
         });
     }
 
     void OnTick(sys::error_code ec) {
-        using namespace std::chrono;
-
-        if (!ec) {
-            auto this_tick = Clock::now();
-            auto delta = duration_cast<milliseconds>(this_tick - last_tick_);
-            last_tick_ = this_tick;
-            try {
-                handler_(delta);
-            } catch (const std::exception& e) {
-            }
-            ScheduleTick();
+        if (ec) {
+            return;
         }
+
+        const auto lateness = std::max(Clock::now() - next_deadline_, Clock::duration::zero());
+        lateness_.Observe(lateness);
+
+        // сколько сроков тиков прошло к текущему моменту
+        const auto due = static_cast<int>(1 + lateness / period_);
+        next_deadline_ += due * period_;
+
+        if (due > 1) {
+            overruns_.Add(static_cast<std::uint64_t>(due - 1));
+        }
+
+        switch (settings_.policy) {
+            case CatchUpPolicy::SKIP:
+                RunHandler(period_);
+                break;
+            case CatchUpPolicy::COALESCE:
+                RunHandler(due * period_);
+                break;
+            case CatchUpPolicy::SUBSTEPS:
+                for (int i = 0; i < std::min(due, std::max(1, settings_.max_substeps)); ++i) {
+                    RunHandler(period_);
+                }
+                break;
+        }
+
+        ScheduleTick();
     }
 
-    using Clock = std::chrono::steady_clock;
+    void RunHandler(std::chrono::milliseconds delta) {
+        try {
+            handler_(delta);
+        } catch (const std::exception& e) {
+        }
+    }
 
     Strand strand_;
     std::chrono::milliseconds period_;
     net::steady_timer timer_{strand_};
     Handler handler_;
-    std::chrono::steady_clock::time_point last_tick_;
+    Settings settings_;
+    metrics::Counter& overruns_;
+    metrics::Histogram& lateness_;
+    Clock::time_point next_deadline_;
 };
@@ -0,0 +1,155 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace trace {
+
+namespace {
+
+// Отрезков в буфере потока (32 байта каждый)
+constexpr std::size_t BUFFER_CAPACITY = 1 << 15;
+
+struct Event {
+    std::string_view name;
+    std::int64_t start_ns;     // от начала работы программы
+    std::int64_t duration_ns;
+};
+
+// Кольцевой буфер потока. Мьютекс берет еще только выгрузка, поэтому
+// при записи он почти всегда свободен
+struct ThreadBuffer {
+    explicit ThreadBuffer(unsigned thread_id) : tid(thread_id) {
+        events.reserve(BUFFER_CAPACITY);
+    }
+
+    std::mutex mutex;
+    std::vector<Event> events;
+    std::size_t next = 0;       // куда пишется следующий отрезок после заполнения
+    const unsigned tid;
+    bool exited = false;        // поток завершился, буфер удаляется после выгрузки
+};
+
+const Clock::time_point EPOCH = Clock::now();
+
+class Buffers {
+public:
+    static Buffers& Instance() {
+        static Buffers buffers;
+        return buffers;
+    }
+
+    std::shared_ptr<ThreadBuffer> Register() {
+        std::lock_guard lock{mutex_};
+        buffers_.push_back(std::make_shared<ThreadBuffer>(next_tid_++));
+        return buffers_.back();
+    }
+
+    // Снимок буферов; буферы завершившихся потоков попадают в него последний раз
+    std::vector<std::shared_ptr<ThreadBuffer>> Take() {
+        std::lock_guard lock{mutex_};
+        auto result = buffers_;
+        std::erase_if(buffers_, [](const auto& buffer) {
+            std::lock_guard buffer_lock{buffer->mutex};
+            return buffer->exited;
+        });
+        return result;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+    unsigned next_tid_ = 1;
+};
+
+// Регистрирует буфер при первом отрезке потока и помечает его при выходе потока
+class LocalBuffer {
+public:
+    LocalBuffer() : buffer_(Buffers::Instance().Register()) {}
+
+    ~LocalBuffer() {
+        std::lock_guard lock{buffer_->mutex};
+        buffer_->exited = true;
+    }
+
+    ThreadBuffer& Get() noexcept {
+        return *buffer_;
+    }
+
+private:
+    std::shared_ptr<ThreadBuffer> buffer_;
+};
+
+// Имена отрезков - литералы из кода, экранируются только на всякий случай
+void AppendEscaped(std::string& out, std::string_view str) {
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += static_cast<unsigned char>(c) < 0x20 ? ' ' : c;
+    }
+}
+
+void AppendMicros(std::string& out, std::int64_t nanoseconds) {
+    char buffer[32];
+    const int size = std::snprintf(buffer, sizeof(buffer), "%.3f", static_cast<double>(nanoseconds) / 1000.0);
+    out.append(buffer, static_cast<std::size_t>(std::max(size, 0)));
+}
+
+} // namespace
+
+void Complete(std::string_view name, Clock::time_point start, Clock::duration duration) noexcept {
+    thread_local LocalBuffer local;
+    auto& buffer = local.Get();
+
+    const Event event{
+        name,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(start - EPOCH).count(),
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()};
+
+    std::lock_guard lock{buffer.mutex};
+    if (buffer.events.size() < BUFFER_CAPACITY) {
+        buffer.events.push_back(event);
+    } else {
+        buffer.events[buffer.next] = event;
+        buffer.next = (buffer.next + 1) % BUFFER_CAPACITY;
+    }
+}
+
+std::string DumpChromeJson() {
+    std::string out = R"({"displayTimeUnit":"ms","traceEvents":[)";
+    bool first = true;
+
+    for (const auto& buffer : Buffers::Instance().Take()) {
+        // копия под мьютексом, чтобы не задерживать поток на время форматирования
+        std::vector<Event> events;
+        {
+            std::lock_guard lock{buffer->mutex};
+            events = buffer->events;
+            std::rotate(events.begin(), events.begin() + static_cast<std::ptrdiff_t>(buffer->next), events.end());
+        }
+
+        for (const auto& event : events) {
+            out += first ? "" : ",";
+            first = false;
+            out += R"({"ph":"X","pid":1,"tid":)";
+            out += std::to_string(buffer->tid);
+            out += R"(,"name":")";
+            AppendEscaped(out, event.name);
+            out += R"(","ts":)";
+            AppendMicros(out, event.start_ns);
+            out += R"(,"dur":)";
+            AppendMicros(out, event.duration_ns);
+            out += '}';
+        }
+    }
+
+    out += "]}";
+    return out;
+}
+
+}  // namespace trace
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+
+namespace trace {
+
+/*
+ *  Трассировка отрезков времени для просмотра на временной шкале
+ *  (chrome://tracing, ui.perfetto.dev). Собирается только с -DGAME_TRACING=ON,
+ *  иначе макросы TRACE_* ничего не делают и не вычисляют аргументы.
+ *
+ *  Каждый поток пишет отрезки в свой кольцевой буфер, поэтому запись не
+ *  конкурирует с другими потоками. В буфере остаются последние отрезки потока.
+ *  Выгрузка в формате Chrome trace event JSON - GET /debug/trace на служебном порту (--admin-port).
+ */
+#ifdef GAME_TRACING
+inline constexpr bool ENABLED = true;
+#else
+inline constexpr bool ENABLED = false;
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// Записывает отрезок потока. name должен жить до конца программы (строковый литерал)
+void Complete(std::string_view name, Clock::time_point start, Clock::duration duration) noexcept;
+
+// Отрезки всех потоков в формате Chrome trace event JSON
+std::string DumpChromeJson();
+
+// Записывает отрезок от создания до разрушения объекта
+class Span {
+public:
+    explicit Span(std::string_view name) noexcept
+        : name_(name)
+        , start_(Clock::now()) {
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    ~Span() {
+        Complete(name_, start_, Clock::now() - start_);
+    }
+
+private:
+    std::string_view name_;
+    Clock::time_point start_;
+};
+
+}  // namespace trace
+
+#ifdef GAME_TRACING
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SPAN(name) ::trace::Span TRACE_CONCAT(trace_span_, __LINE__){name}
+#define TRACE_COMPLETE(name, start, duration) ::trace::Complete(name, start, duration)
+#else
+#define TRACE_SPAN(name) static_cast<void>(0)
+#define TRACE_COMPLETE(name, start, duration) static_cast<void>(0)
+#endif
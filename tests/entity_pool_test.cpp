@@ -0,0 +1,72 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+#include "entity_pool.h"
+
+namespace {
+
+using Pool = util::EntityPool<std::string>;
+
+std::vector<std::string> Items(const Pool& pool) {
+    return {pool.begin(), pool.end()};
+}
+
+} // namespace
+
+TEST_CASE("EraseIf keeps the order and the handles of remaining objects", "[entity_pool]") {
+    Pool pool;
+    std::vector<Pool::Handle> handles;
+    for (const char* name : {"a", "b", "c", "d", "e", "f"}) {
+        handles.push_back(pool.Add(name));
+    }
+
+    std::vector<std::string> visited;
+    const auto removed = pool.EraseIf([&visited](const std::string& item) {
+        visited.push_back(item);
+        return item == "a" || item == "c" || item == "d";
+    });
+
+    CHECK(removed == 3);
+    CHECK(visited == std::vector<std::string>{"a", "b", "c", "d", "e", "f"});
+    CHECK(Items(pool) == std::vector<std::string>{"b", "e", "f"});
+
+    CHECK(pool.Get(handles[0]) == nullptr);
+    CHECK(pool.Get(handles[2]) == nullptr);
+    CHECK(pool.Get(handles[3]) == nullptr);
+    CHECK(*pool.Get(handles[1]) == "b");
+    CHECK(*pool.Get(handles[4]) == "e");
+    CHECK(*pool.Get(handles[5]) == "f");
+
+    for (std::size_t i = 0; i < pool.Size(); ++i) {
+        CHECK(*pool.Get(pool.HandleAt(i)) == pool[i]);
+    }
+}
+
+TEST_CASE("Slots freed by EraseIf are reused with a new generation", "[entity_pool]") {
+    Pool pool;
+    const auto old_handle = pool.Add("old");
+    pool.Add("kept");
+
+    CHECK(pool.EraseIf([](const std::string& item) { return item == "old"; }) == 1);
+
+    const auto new_handle = pool.Add("new");
+    CHECK(new_handle.slot == old_handle.slot);
+    CHECK(pool.Get(old_handle) == nullptr);
+    CHECK(*pool.Get(new_handle) == "new");
+    CHECK(Items(pool) == std::vector<std::string>{"kept", "new"});
+}
+
+TEST_CASE("EraseIf on an empty pool or with nothing to erase", "[entity_pool]") {
+    Pool pool;
+    CHECK(pool.EraseIf([](const std::string&) { return true; }) == 0);
+
+    const auto handle = pool.Add("x");
+    CHECK(pool.EraseIf([](const std::string&) { return false; }) == 0);
+    CHECK(*pool.Get(handle) == "x");
+
+    CHECK(pool.EraseIf([](const std::string&) { return true; }) == 1);
+    CHECK(pool.Empty());
+    CHECK(pool.Get(handle) == nullptr);
+}
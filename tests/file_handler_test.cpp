@@ -0,0 +1,77 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "file_handler.h"
+
+using file_handler::ParseRange;
+
+namespace {
+
+constexpr std::uint64_t SIZE = 1000;
+
+void CheckRange(std::string_view header, std::uint64_t first, std::uint64_t last) {
+    INFO(header);
+    const auto range = ParseRange(header, SIZE);
+    REQUIRE(range);
+    CHECK(range->satisfiable);
+    CHECK(range->first == first);
+    CHECK(range->last == last);
+}
+
+void CheckUnsatisfiable(std::string_view header, std::uint64_t size = SIZE) {
+    INFO(header);
+    const auto range = ParseRange(header, size);
+    REQUIRE(range);
+    CHECK_FALSE(range->satisfiable);
+}
+
+// Заголовок игнорируется, файл отдается целиком
+void CheckIgnored(std::string_view header) {
+    INFO(header);
+    CHECK_FALSE(ParseRange(header, SIZE));
+}
+
+} // namespace
+
+TEST_CASE("Single byte ranges", "[range]") {
+    CheckRange("bytes=0-99", 0, 99);
+    CheckRange("bytes=0-0", 0, 0);
+    CheckRange("bytes=999-999", 999, 999);
+    CheckRange("bytes=500-", 500, 999);
+}
+
+TEST_CASE("Last byte is clamped to the file size", "[range]") {
+    CheckRange("bytes=990-2000", 990, 999);
+    CheckRange("bytes=0-18446744073709551615", 0, 999);
+}
+
+TEST_CASE("Suffix ranges", "[range]") {
+    CheckRange("bytes=-100", 900, 999);
+    CheckRange("bytes=-1", 999, 999);
+    CheckRange("bytes=-2000", 0, 999);
+}
+
+TEST_CASE("Unsatisfiable ranges", "[range]") {
+    // пустой суффикс и начало за концом файла
+    CheckUnsatisfiable("bytes=-0");
+    CheckUnsatisfiable("bytes=1000-");
+    CheckUnsatisfiable("bytes=1000-1200");
+    CheckUnsatisfiable("bytes=5000-6000");
+
+    // у пустого файла нет ни одного байта
+    CheckUnsatisfiable("bytes=0-", 0);
+    CheckUnsatisfiable("bytes=-5", 0);
+}
+
+TEST_CASE("Invalid and unsupported ranges are ignored", "[range]") {
+    CheckIgnored("bytes=10-5");
+    CheckIgnored("bytes=0-1,5-6");
+    CheckIgnored("bytes=-5,10-");
+    CheckIgnored("items=0-1");
+    CheckIgnored("bytes=");
+    CheckIgnored("bytes=-");
+    CheckIgnored("bytes=abc");
+    CheckIgnored("bytes=1-x");
+    CheckIgnored("bytes=x-1");
+    CheckIgnored("bytes= 1-2");
+    CheckIgnored("bytes=99999999999999999999-");
+}
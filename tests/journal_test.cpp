@@ -0,0 +1,179 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "journal.h"
+
+using namespace std::literals;
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// Каталог для сегментов одного теста, удаляется в деструкторе
+class TempDir {
+public:
+    explicit TempDir(std::string_view name) : path_(fs::temp_directory_path() / name) {
+        fs::remove_all(path_);
+        fs::create_directories(path_);
+    }
+
+    ~TempDir() {
+        std::error_code ec;
+        fs::remove_all(path_, ec);
+    }
+
+    std::string Prefix() const {
+        return (path_ / "journal").string();
+    }
+
+    std::string Segment(std::uint64_t segment) const {
+        return Prefix() + "." + std::to_string(segment);
+    }
+
+private:
+    fs::path path_;
+};
+
+std::string ReadFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+void WriteFile(const std::string& path, const std::string& data) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << data;
+}
+
+// Пишет события с dog_id из ids в сегменты начиная с segment, по events_per_segment в каждый
+void WriteJournal(const std::string& prefix, std::uint64_t segment, const std::vector<int>& ids,
+                  std::size_t events_per_segment) {
+    journal::Journal journal({prefix, 1h}, segment);
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        if (i > 0 && i % events_per_segment == 0) {
+            journal.Flush();
+            journal.Rotate();
+        }
+        journal.Append(journal::RetireEvent{ids[i]});
+    }
+    journal.Flush();
+}
+
+std::vector<int> ReplayIds(const std::string& prefix) {
+    std::vector<int> ids;
+    journal::Journal::Replay(prefix, 0, [&ids](const journal::Event& event) {
+        ids.push_back(std::get<journal::RetireEvent>(event).dog_id);
+    });
+    return ids;
+}
+
+std::size_t RecordSize(const journal::Event& event) {
+    std::string record;
+    journal::EncodeRecord(record, event);
+    return record.size();
+}
+
+} // namespace
+
+TEST_CASE("Journal record round trip", "[journal]") {
+    const std::vector<journal::Event> events = {
+        journal::JoinEvent{42, 7, "token"s, "Rex"s, "map1"s, 1.5, -2.25},
+        journal::MoveEvent{7, "L"s},
+        journal::TickEvent{100, 0xDEADBEEFull},
+        journal::RetireEvent{7},
+    };
+
+    std::string data;
+    for (const auto& event : events) {
+        journal::EncodeRecord(data, event);
+    }
+
+    std::string_view rest = data;
+    for (const auto& expected : events) {
+        const auto event = journal::DecodeRecord(rest);
+        REQUIRE(event);
+        CHECK(event->index() == expected.index());
+    }
+    CHECK(rest.empty());
+
+    std::string_view join_record = data;
+    const auto join = std::get<journal::JoinEvent>(*journal::DecodeRecord(join_record));
+    CHECK(join.player_id == 42);
+    CHECK(join.dog_id == 7);
+    CHECK(join.token == "token");
+    CHECK(join.name == "Rex");
+    CHECK(join.map_id == "map1");
+    CHECK(join.x == 1.5);
+    CHECK(join.y == -2.25);
+}
+
+TEST_CASE("Journal record decoding rejects truncated and corrupted records", "[journal]") {
+    std::string data;
+    journal::EncodeRecord(data, journal::MoveEvent{3, "U"s});
+
+    SECTION("truncated record leaves data unchanged") {
+        for (std::size_t size = 0; size < data.size(); ++size) {
+            std::string_view rest = std::string_view(data).substr(0, size);
+            CHECK_FALSE(journal::DecodeRecord(rest));
+            CHECK(rest.size() == size);
+        }
+    }
+
+    SECTION("flipped payload byte fails the checksum") {
+        data.back() ^= 0x01;
+        std::string_view rest = data;
+        CHECK_FALSE(journal::DecodeRecord(rest));
+        CHECK(rest.size() == data.size());
+    }
+}
+
+TEST_CASE("Journal replays flushed events in order", "[journal]") {
+    TempDir dir("game_tests_journal_order");
+    const std::vector<int> ids = {1, 2, 3, 4, 5, 6, 7};
+    WriteJournal(dir.Prefix(), 1, ids, 3);
+
+    CHECK(ReplayIds(dir.Prefix()) == ids);
+    CHECK(journal::Journal::Replay(dir.Prefix(), 0, [](const journal::Event&) {}) == 3);
+    CHECK(journal::Journal::Replay(dir.Prefix(), 3, [](const journal::Event&) {}) == 3);
+}
+
+TEST_CASE("Journal replay skips a torn tail and continues with the next segment", "[journal]") {
+    TempDir dir("game_tests_journal_torn");
+    WriteJournal(dir.Prefix(), 1, {1, 2, 3, 4, 5}, 3);
+
+    // последняя запись первого сегмента оборвана посередине
+    const auto segment = dir.Segment(1);
+    const auto data = ReadFile(segment);
+    const auto record_size = RecordSize(journal::RetireEvent{3});
+    REQUIRE(data.size() == 3 * record_size);
+    fs::resize_file(segment, data.size() - record_size / 2);
+
+    CHECK(ReplayIds(dir.Prefix()) == std::vector{1, 2, 4, 5});
+}
+
+TEST_CASE("Journal replay stops a segment at a corrupted record", "[journal]") {
+    TempDir dir("game_tests_journal_corrupt");
+    WriteJournal(dir.Prefix(), 1, {1, 2, 3, 4, 5}, 3);
+
+    // порча тела второй записи: она и все после нее в сегменте не применяются
+    const auto segment = dir.Segment(1);
+    auto data = ReadFile(segment);
+    const auto record_size = RecordSize(journal::RetireEvent{2});
+    data[2 * record_size - 1] ^= 0x01;
+    WriteFile(segment, data);
+
+    CHECK(ReplayIds(dir.Prefix()) == std::vector{1, 4, 5});
+}
+
+TEST_CASE("Journal appends after a restart go to a new segment", "[journal]") {
+    TempDir dir("game_tests_journal_restart");
+    WriteJournal(dir.Prefix(), 1, {1, 2}, 10);
+
+    const auto last = journal::Journal::Replay(dir.Prefix(), 0, [](const journal::Event&) {});
+    WriteJournal(dir.Prefix(), last + 1, {3}, 10);
+
+    CHECK(ReplayIds(dir.Prefix()) == std::vector{1, 2, 3});
+}
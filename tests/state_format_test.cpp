@@ -0,0 +1,245 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include "byte_codec.h"
+#include "state_format.h"
+
+using namespace std::literals;
+using Catch::Matchers::ContainsSubstring;
+
+namespace {
+
+using serialization::BinaryStateFormat;
+
+// Две сессии на одной карте: собаки с рюкзаками, лут на карте и игроки
+serialization::GameStateRepr MakeState() {
+    serialization::GameStateRepr state;
+    state.journal_segment = 17;
+    state.loot_time_without_loot = 1234;
+    state.next_loot_id = 500;
+    state.next_session_id = 9;
+
+    auto map = std::make_shared<model::Map>(model::Map::Id("map1"s), "Map 1"s);
+    int loot_id = 0;
+
+    for (int s = 0; s < 2; ++s) {
+        auto session = std::make_shared<model::GameSession>(s, map);
+
+        model::Loots loots;
+        for (int i = 0; i < 3; ++i) {
+            loots.emplace_back(loot_id++, i, model::Coords{i * 0.5, s + 0.25});
+            state.loots.emplace_back(loots.back());
+        }
+        session->AddLoots(loots);
+
+        for (int i = 0; i < 2; ++i) {
+            const int id = s * 10 + i;
+            model::Dog dog(id, "dog"s + std::to_string(id));
+            dog.SetCords({i * 1.5, s * 2.5});
+            dog.SetSpeed({0.5, -0.5});
+            dog.SetDirection(model::Direction::WEST);
+            dog.SetScore(i * 7);
+            model::Loot loot(loot_id++, 1, dog.GetCords());
+            dog.TakeLoot(loot);
+            state.loots.emplace_back(loot);
+
+            state.dogs.emplace_back(dog);
+            const auto handle = session->AddDog(std::move(dog));
+            state.players.emplace_back(
+                std::make_shared<Player>(id, "token" + std::to_string(id), handle, id, session));
+        }
+        state.sessions.emplace_back(session);
+    }
+
+    return state;
+}
+
+// Текстовый архив пишет все поля представлений, поэтому по нему сравниваются состояния
+std::string EncodeText(const serialization::GameStateRepr& state) {
+    std::ostringstream out;
+    boost::archive::text_oarchive oa(out);
+    state.Write(oa);
+    return std::move(out).str();
+}
+
+codec::FileHeader ReadHeader(const std::string& data) {
+    codec::FileHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    return header;
+}
+
+// Записывает заголовок и пересчитывает контрольную сумму, чтобы порча
+// доходила до проверок за ней
+void RewriteHeader(std::string& data, codec::FileHeader header) {
+    std::memcpy(data.data(), &header, sizeof(header));
+    header.checksum = codec::Checksum(std::string_view(data).substr(sizeof(header)));
+    std::memcpy(data.data(), &header, sizeof(header));
+}
+
+codec::SectionEntry ReadSection(const std::string& data, std::size_t index) {
+    codec::SectionEntry section;
+    std::memcpy(&section, data.data() + sizeof(codec::FileHeader) + index * sizeof(section), sizeof(section));
+    return section;
+}
+
+void WriteSection(std::string& data, std::size_t index, const codec::SectionEntry& section) {
+    std::memcpy(data.data() + sizeof(codec::FileHeader) + index * sizeof(section), &section, sizeof(section));
+    RewriteHeader(data, ReadHeader(data));
+}
+
+} // namespace
+
+TEST_CASE("State file round trip", "[state]") {
+    const auto state = MakeState();
+    const auto data = BinaryStateFormat::Encode(state);
+
+    REQUIRE(BinaryStateFormat::IsBinary(data));
+    CHECK(ReadHeader(data).version == serialization::STATE_FORMAT_VERSION);
+
+    const auto decoded = BinaryStateFormat::Decode(data);
+    CHECK(decoded.loots.size() == state.loots.size());
+    CHECK(decoded.dogs.size() == state.dogs.size());
+    CHECK(decoded.sessions.size() == state.sessions.size());
+    CHECK(decoded.players.size() == state.players.size());
+    CHECK(decoded.journal_segment == 17);
+    CHECK(decoded.loot_time_without_loot == 1234);
+    CHECK(decoded.next_loot_id == 500);
+    CHECK(decoded.next_session_id == 9);
+    CHECK(EncodeText(decoded) == EncodeText(state));
+    CHECK(BinaryStateFormat::Encode(decoded) == data);
+}
+
+TEST_CASE("Empty state round trip", "[state]") {
+    const serialization::GameStateRepr state;
+    const auto decoded = BinaryStateFormat::Decode(BinaryStateFormat::Encode(state));
+    CHECK(EncodeText(decoded) == EncodeText(state));
+    CHECK(decoded.journal_segment == 0);
+}
+
+TEST_CASE("Version 1 state files are read without the meta section", "[state]") {
+    auto data = BinaryStateFormat::Encode(MakeState());
+
+    // в версии 1 не было последней секции; ее запись в таблице остается, но не читается
+    auto header = ReadHeader(data);
+    header.version = 1;
+    header.section_count = 6;
+    RewriteHeader(data, header);
+
+    const auto decoded = BinaryStateFormat::Decode(data);
+    CHECK(EncodeText(decoded) == EncodeText(MakeState()));
+    CHECK(decoded.journal_segment == 0);
+    CHECK(decoded.loot_time_without_loot == 0);
+    CHECK(decoded.next_loot_id == 0);
+}
+
+TEST_CASE("Version 2 state files are read without id counters", "[state]") {
+    auto data = BinaryStateFormat::Encode(MakeState());
+
+    // в версии 2 запись последней секции короче: в ней нет счетчиков id
+    constexpr std::size_t META = 6;
+    constexpr std::size_t META_V2_SIZE = 16;
+    auto section = ReadSection(data, META);
+    section.record_size = META_V2_SIZE;
+    section.size = META_V2_SIZE;
+    WriteSection(data, META, section);
+
+    auto header = ReadHeader(data);
+    header.version = 2;
+    RewriteHeader(data, header);
+
+    const auto decoded = BinaryStateFormat::Decode(data);
+    CHECK(EncodeText(decoded) == EncodeText(MakeState()));
+    CHECK(decoded.journal_segment == 17);
+    CHECK(decoded.loot_time_without_loot == 1234);
+    CHECK(decoded.next_loot_id == 0);
+    CHECK(decoded.next_session_id == 0);
+
+    SECTION("a version 3 meta record in a version 2 file is rejected") {
+        section.record_size = section.size = 24;
+        WriteSection(data, META, section);
+        CHECK_THROWS_WITH(BinaryStateFormat::Decode(data), ContainsSubstring("bad section 6"));
+    }
+}
+
+TEST_CASE("Corrupted state files are rejected", "[state]") {
+    auto data = BinaryStateFormat::Encode(MakeState());
+
+    SECTION("bad signature") {
+        data[0] = 'X';
+        CHECK_THROWS_WITH(BinaryStateFormat::Decode(data), ContainsSubstring("bad signature"));
+    }
+
+    SECTION("shorter than the header") {
+        CHECK_THROWS_WITH(BinaryStateFormat::Decode(data.substr(0, 16)), ContainsSubstring("bad signature"));
+    }
+
+    SECTION("truncated file") {
+        data.resize(data.size() - 8);
+        CHECK_THROWS_WITH(BinaryStateFormat::Decode(data), ContainsSubstring("size mismatch"));
+    }
+
+    SECTION("flipped byte in a section") {
+        data[data.size() / 2] ^= 0x01;
+        CHECK_THROWS_WITH(BinaryStateFormat::Decode(data), ContainsSubstring("checksum mismatch"));
+    }
+
+    SECTION("flipped byte in the section table") {
+        data[sizeof(codec::FileHeader) + 1] ^= 0x01;
+        CHECK_THROWS_WITH(BinaryStateFormat::Decode(data), ContainsSubstring("checksum mismatch"));
+    }
+
+    SECTION("unknown version") {
+        auto header = ReadHeader(data);
+        header.version = serialization::STATE_FORMAT_VERSION + 1;
+        RewriteHeader(data, header);
+        CHECK_THROWS_WITH(BinaryStateFormat::Decode(data), ContainsSubstring("Unsupported state file version"));
+    }
+
+    SECTION("section count does not match the version") {
+        auto header = ReadHeader(data);
+        header.section_count = 6;
+        RewriteHeader(data, header);
+        CHECK_THROWS_WITH(BinaryStateFormat::Decode(data), ContainsSubstring("bad section table"));
+    }
+
+    SECTION("section out of the file") {
+        auto section = ReadSection(data, 1);
+        section.offset = data.size() - section.size / 2;
+        WriteSection(data, 1, section);
+        CHECK_THROWS_WITH(BinaryStateFormat::Decode(data), ContainsSubstring("bad section 1"));
+    }
+
+    SECTION("section with a wrong record size") {
+        auto section = ReadSection(data, 2);
+        section.record_size += 1;
+        WriteSection(data, 2, section);
+        CHECK_THROWS_WITH(BinaryStateFormat::Decode(data), ContainsSubstring("bad section 2"));
+    }
+
+    SECTION("section size does not match its count") {
+        auto section = ReadSection(data, 0);
+        section.count += 1;
+        WriteSection(data, 0, section);
+        CHECK_THROWS_WITH(BinaryStateFormat::Decode(data), ContainsSubstring("bad section 0"));
+    }
+
+    SECTION("strings referenced past the string section") {
+        // секция строк укорочена: имена собак и токены выходят за ее границу
+        auto section = ReadSection(data, 5);
+        section.size = section.count = 1;
+        WriteSection(data, 5, section);
+        CHECK_THROWS_WITH(BinaryStateFormat::Decode(data), ContainsSubstring("string out of range"));
+    }
+
+    SECTION("id ranges past the id section") {
+        auto section = ReadSection(data, 4);
+        section.count = 0;
+        section.size = 0;
+        WriteSection(data, 4, section);
+        CHECK_THROWS_WITH(BinaryStateFormat::Decode(data), ContainsSubstring("range out of section"));
+    }
+}
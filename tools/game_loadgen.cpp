@@ -0,0 +1,326 @@
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/json.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "http_client.h"
+#include "metrics.h"
+
+// Нагрузочный клиент игрового сервера. Боты проходят тот же путь, что и браузерный
+// клиент: входят в игру на разных картах, меняют направление с паузами на раздумье,
+// опрашивают состояние игры и таблицу рекордов. Каждый поток держит одно keep-alive
+// соединение и по очереди обслуживает своих ботов. В конце печатаются пропускная
+// способность и перцентили задержки по каждой точке API:
+//   game_loadgen --bots 1000 --threads 8 --duration 60
+namespace {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+namespace json = boost::json;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+using namespace std::literals;
+
+enum Endpoint {
+    JOIN,
+    ACTION,
+    STATE,
+    RECORDS,
+    ENDPOINT_COUNT
+};
+
+constexpr std::array<std::string_view, ENDPOINT_COUNT> ENDPOINT_NAMES{"join", "action", "state", "records"};
+
+constexpr std::string_view REQUEST_MAPS = "/api/v1/maps"sv;
+constexpr std::string_view REQUEST_JOIN = "/api/v1/game/join"sv;
+constexpr std::string_view REQUEST_ACTION = "/api/v1/game/player/action"sv;
+constexpr std::string_view REQUEST_STATE = "/api/v1/game/state"sv;
+constexpr std::string_view REQUEST_RECORDS = "/api/v1/game/records?start=0&maxItems=100"sv;
+
+constexpr std::array<std::string_view, 5> MOVES{"L", "R", "U", "D", ""};
+
+struct Args {
+    std::string host = "127.0.0.1";
+    std::string port = "8080";
+    unsigned bots = 100;
+    unsigned threads = 4;
+    unsigned duration = 30;                 // секунды
+    unsigned think_time = 500;              // мс между сменами направления
+    unsigned state_period = 100;            // мс между опросами состояния
+    unsigned records_period = 5000;         // мс между запросами рекордов
+    std::vector<std::string> maps;          // по умолчанию - все карты сервера
+    std::uint64_t seed = 42;
+};
+
+[[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
+    namespace po = boost::program_options;
+
+    po::options_description desc{"Allowed options"s};
+    Args args;
+    desc.add_options()
+        ("help,h", "produce help message")
+        ("host", po::value(&args.host), "server address (127.0.0.1 by default)")
+        ("port", po::value(&args.port), "server port (8080 by default)")
+        ("bots,b", po::value(&args.bots), "number of bots (100 by default)")
+        ("threads,t", po::value(&args.threads), "client threads, one connection each (4 by default)")
+        ("duration,d", po::value(&args.duration), "test duration in seconds (30 by default)")
+        ("think-time", po::value(&args.think_time), "mean pause between direction changes in ms (500 by default)")
+        ("state-period", po::value(&args.state_period), "game state polling period in ms (100 by default)")
+        ("records-period", po::value(&args.records_period), "records polling period in ms (5000 by default)")
+        ("map", po::value(&args.maps)->multitoken(), "map ids to join (all server maps by default)")
+        ("seed", po::value(&args.seed), "random seed (42 by default)");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.contains("help"s)) {
+        std::cout << desc;
+        return std::nullopt;
+    }
+    if (args.bots == 0 || args.threads == 0) {
+        throw std::runtime_error("--bots and --threads must be positive");
+    }
+    args.threads = std::min(args.threads, args.bots);
+
+    return args;
+}
+
+// Задержки ответов одного потока по точкам API, в секундах
+struct Stats {
+    std::array<std::vector<double>, ENDPOINT_COUNT> latencies;
+    std::array<std::uint64_t, ENDPOINT_COUNT> errors{};
+
+    void Merge(Stats&& other) {
+        for (int i = 0; i < ENDPOINT_COUNT; ++i) {
+            latencies[i].insert(latencies[i].end(), other.latencies[i].begin(), other.latencies[i].end());
+            errors[i] += other.errors[i];
+        }
+    }
+};
+
+using http_client::Client;
+
+http::request<http::string_body> MakeRequest(http::verb method, std::string_view target, std::string body = {},
+                                             const std::string& token = {}) {
+    http::request<http::string_body> request{method, std::string(target), 11};
+    request.set(http::field::host, "loadgen");
+    request.keep_alive(true);
+    if (!token.empty()) {
+        request.set(http::field::authorization, "Bearer " + token);
+    }
+    if (method == http::verb::post) {
+        request.set(http::field::content_type, "application/json");
+        request.body() = std::move(body);
+    }
+    request.prepare_payload();
+    return request;
+}
+
+struct Bot {
+    std::string name;
+    std::string map_id;
+    std::string token;
+    Clock::time_point next_action;
+    Clock::time_point next_state;
+    Clock::time_point next_records;
+};
+
+class Worker {
+public:
+    Worker(const Args& args, tcp::resolver::results_type endpoints, std::vector<Bot> bots, std::uint64_t seed)
+        : args_(args)
+        , client_(ioc_, std::move(endpoints))
+        , bots_(std::move(bots))
+        , random_(seed) {
+    }
+
+    Stats Run(Clock::time_point deadline) {
+        for (auto& bot : bots_) {
+            Join(bot);
+        }
+
+        std::uniform_int_distribution<std::size_t> pick_move(0, MOVES.size() - 1);
+
+        while (Clock::now() < deadline) {
+            auto next_event = deadline;
+
+            for (auto& bot : bots_) {
+                if (bot.token.empty()) {
+                    continue;
+                }
+                const auto now = Clock::now();
+                if (now >= bot.next_action) {
+                    json::object body{{"move", MOVES[pick_move(random_)]}};
+                    Send(ACTION, http::verb::post, REQUEST_ACTION, json::serialize(body), bot.token);
+                    bot.next_action = now + ThinkTime();
+                }
+                if (now >= bot.next_state) {
+                    Send(STATE, http::verb::get, REQUEST_STATE, {}, bot.token);
+                    bot.next_state = now + std::chrono::milliseconds(args_.state_period);
+                }
+                if (now >= bot.next_records) {
+                    Send(RECORDS, http::verb::get, REQUEST_RECORDS);
+                    bot.next_records = now + std::chrono::milliseconds(args_.records_period);
+                }
+                next_event = std::min({next_event, bot.next_action, bot.next_state, bot.next_records});
+            }
+
+            std::this_thread::sleep_until(next_event);
+        }
+
+        return std::move(stats_);
+    }
+
+private:
+    // Паузы на раздумье распределены экспоненциально со средним --think-time
+    Clock::duration ThinkTime() {
+        std::exponential_distribution<double> think(1.0 / std::max(1u, args_.think_time));
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(think(random_)));
+    }
+
+    void Join(Bot& bot) {
+        json::object body{{"userName", bot.name}, {"mapId", bot.map_id}};
+        auto response = Send(JOIN, http::verb::post, REQUEST_JOIN, json::serialize(body));
+        if (!response || response->result() != http::status::ok) {
+            return;
+        }
+
+        bot.token = std::string(json::parse(response->body()).as_object().at("authToken").as_string());
+
+        // ботов разносим по времени, чтобы они не шли синхронными волнами
+        const auto now = Clock::now();
+        std::uniform_int_distribution<unsigned> offset(0, std::max({args_.think_time, args_.state_period, 1u}));
+        bot.next_action = now + std::chrono::milliseconds(offset(random_));
+        bot.next_state = now + std::chrono::milliseconds(offset(random_) % std::max(1u, args_.state_period));
+        bot.next_records = now + std::chrono::milliseconds(args_.records_period);
+    }
+
+    std::optional<Client::Response> Send(Endpoint endpoint, http::verb method, std::string_view target,
+                                         std::string body = {}, const std::string& token = {}) {
+        const auto start = Clock::now();
+        try {
+            auto response = client_.Request(MakeRequest(method, target, std::move(body), token));
+            stats_.latencies[endpoint].push_back(std::chrono::duration<double>(Clock::now() - start).count());
+            if (response.result() != http::status::ok) {
+                ++stats_.errors[endpoint];
+            }
+            return response;
+        } catch (const std::exception&) {
+            ++stats_.errors[endpoint];
+            return std::nullopt;
+        }
+    }
+
+    const Args& args_;
+    net::io_context ioc_;
+    Client client_;
+    std::vector<Bot> bots_;
+    std::mt19937_64 random_;
+    Stats stats_;
+};
+
+std::vector<std::string> FetchMaps(net::io_context& ioc, const tcp::resolver::results_type& endpoints) {
+    Client client(ioc, endpoints);
+    const auto response = client.Request(MakeRequest(http::verb::get, REQUEST_MAPS));
+    if (response.result() != http::status::ok) {
+        throw std::runtime_error("Cannot get map list: "s + std::string(http::obsolete_reason(response.result())));
+    }
+
+    std::vector<std::string> maps;
+    for (const auto& map : json::parse(response.body()).as_array()) {
+        maps.push_back(std::string(map.as_object().at("id").as_string()));
+    }
+    if (maps.empty()) {
+        throw std::runtime_error("Server has no maps");
+    }
+    return maps;
+}
+
+void PrintReport(Stats& stats, std::chrono::duration<double> elapsed) {
+    std::cout << std::left << std::setw(10) << "endpoint" << std::right
+              << std::setw(12) << "requests" << std::setw(10) << "errors" << std::setw(12) << "req/s"
+              << std::setw(12) << "p50, ms" << std::setw(12) << "p99, ms" << std::setw(12) << "p999, ms" << '\n';
+
+    std::uint64_t total = 0;
+    for (int i = 0; i < ENDPOINT_COUNT; ++i) {
+        auto& latencies = stats.latencies[i];
+        std::sort(latencies.begin(), latencies.end());
+        total += latencies.size();
+
+        std::cout << std::left << std::setw(10) << ENDPOINT_NAMES[i] << std::right << std::fixed
+                  << std::setw(12) << latencies.size() << std::setw(10) << stats.errors[i]
+                  << std::setprecision(1) << std::setw(12) << static_cast<double>(latencies.size()) / elapsed.count()
+                  << std::setprecision(3)
+                  << std::setw(12) << metrics::Percentile(latencies, 0.5) * 1000
+                  << std::setw(12) << metrics::Percentile(latencies, 0.99) * 1000
+                  << std::setw(12) << metrics::Percentile(latencies, 0.999) * 1000 << '\n';
+    }
+
+    std::cout << "total: " << total << " requests in " << std::setprecision(1) << elapsed.count() << " s, "
+              << static_cast<double>(total) / elapsed.count() << " req/s" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, const char* argv[]) {
+    try {
+        auto args = ParseCommandLine(argc, argv);
+        if (!args) {
+            return EXIT_SUCCESS;
+        }
+
+        net::io_context ioc;
+        const auto endpoints = tcp::resolver(ioc).resolve(args->host, args->port);
+        if (args->maps.empty()) {
+            args->maps = FetchMaps(ioc, endpoints);
+        }
+
+        // боты раскладываются по картам и потокам по кругу
+        std::vector<std::vector<Bot>> bots(args->threads);
+        for (unsigned i = 0; i < args->bots; ++i) {
+            bots[i % args->threads].push_back(Bot{"bot"s + std::to_string(i), args->maps[i % args->maps.size()]});
+        }
+
+        const auto start = Clock::now();
+        const auto deadline = start + std::chrono::seconds(args->duration);
+
+        std::vector<Stats> results(args->threads);
+        {
+            std::vector<std::jthread> threads;
+            for (unsigned i = 0; i < args->threads; ++i) {
+                threads.emplace_back([&, i] {
+                    Worker worker(*args, endpoints, std::move(bots[i]), args->seed + i);
+                    results[i] = worker.Run(deadline);
+                });
+            }
+        }
+
+        Stats total;
+        for (auto& stats : results) {
+            total.Merge(std::move(stats));
+        }
+        PrintReport(total, Clock::now() - start);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
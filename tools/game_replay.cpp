@@ -0,0 +1,366 @@
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/json.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "http_capture.h"
+#include "http_client.h"
+#include "metrics.h"
+
+// Воспроизводит запись входящих запросов (game_server --capture-http) против
+// запущенного сервера. Запросы каждого клиентского соединения идут по своему
+// keep-alive соединению в исходном порядке, по расписанию записи с ускорением
+// --speed (0 - без пауз, с максимальной скоростью). Токены из ответов на вход
+// подставляются вместо записанных. В конце печатаются перцентили задержки по
+// точкам API и отставание от расписания:
+//   game_replay traffic.cap --speed 2 --threads 8
+namespace {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+namespace json = boost::json;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+using namespace std::literals;
+
+constexpr std::string_view REQUEST_MAPS = "/api/v1/maps/"sv;
+constexpr std::string_view BEARER = "Bearer "sv;
+
+// сколько запрос со старым токеном ждет ответа на вход, выдавшего новый
+constexpr auto TOKEN_WAIT = 5s;
+
+struct Args {
+    std::string capture_file;
+    std::string host = "127.0.0.1";
+    std::string port = "8080";
+    double speed = 1.0;     // 0 - без пауз
+    unsigned threads = 4;
+};
+
+[[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
+    namespace po = boost::program_options;
+
+    po::options_description desc{"Allowed options"s};
+    Args args;
+    desc.add_options()
+        ("help,h", "produce help message")
+        ("capture", po::value(&args.capture_file), "capture file written by game_server --capture-http")
+        ("host", po::value(&args.host), "server address (127.0.0.1 by default)")
+        ("port", po::value(&args.port), "server port (8080 by default)")
+        ("speed,s", po::value(&args.speed), "replay speed: 1 - as captured (default), N - N times faster, 0 - max")
+        ("threads,t", po::value(&args.threads), "client threads, connections are spread over them (4 by default)");
+
+    po::positional_options_description positional;
+    positional.add("capture", 1);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+    po::notify(vm);
+
+    if (vm.contains("help"s)) {
+        std::cout << "Usage: game_replay <capture> [options]\n" << desc;
+        return std::nullopt;
+    }
+    if (args.capture_file.empty()) {
+        throw std::runtime_error("Capture file is not specified");
+    }
+    if (args.threads == 0 || args.speed < 0) {
+        throw std::runtime_error("--threads must be positive and --speed must not be negative");
+    }
+
+    return args;
+}
+
+// Имя точки API для отчета: путь без параметров, id карты заменен на {id}
+std::string EndpointName(std::string_view target) {
+    target = target.substr(0, target.find('?'));
+    if (!target.starts_with("/api/"sv)) {
+        return "static";
+    }
+    if (target.starts_with(REQUEST_MAPS) && target.size() > REQUEST_MAPS.size()) {
+        return std::string(REQUEST_MAPS) + "{id}";
+    }
+    return std::string(target);
+}
+
+// Соответствие записанных токенов выданным при воспроизведении
+class Tokens {
+public:
+    explicit Tokens(const std::vector<http_capture::IssuedToken>& issued) {
+        for (const auto& [request, token] : issued) {
+            issued_by_request_.emplace(request, token);
+            replaced_.emplace(token, std::nullopt);
+        }
+    }
+
+    // Записанный токен, выданный в ответ на запрос, если он есть
+    const std::string* IssuedBy(std::uint64_t request) const {
+        const auto it = issued_by_request_.find(request);
+        return it == issued_by_request_.end() ? nullptr : &it->second;
+    }
+
+    void Replace(const std::string& old_token, std::string new_token) {
+        {
+            std::lock_guard lock{mutex_};
+            if (const auto it = replaced_.find(old_token); it != replaced_.end()) {
+                it->second = std::move(new_token);
+            }
+        }
+        cond_var_.notify_all();
+    }
+
+    // Новый токен вместо записанного. Если вход, выдавший токен, еще не воспроизведен
+    // (идет в другом потоке), ждет его. Неизвестные токены остаются как есть
+    std::string Lookup(const std::string& old_token) {
+        std::unique_lock lock{mutex_};
+        const auto it = replaced_.find(old_token);
+        if (it == replaced_.end()) {
+            return old_token;
+        }
+        cond_var_.wait_for(lock, TOKEN_WAIT, [&it] { return it->second.has_value(); });
+        return it->second.value_or(old_token);
+    }
+
+private:
+    std::unordered_map<std::uint64_t, std::string> issued_by_request_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_var_;
+    std::unordered_map<std::string, std::optional<std::string>> replaced_;
+};
+
+using http_client::Client;
+
+// Задержки ответов одного потока по точкам API и отставание от расписания, в секундах
+struct Stats {
+    std::map<std::string, std::vector<double>> latencies;
+    std::map<std::string, std::uint64_t> errors;
+    std::vector<double> lags;
+
+    void Merge(Stats&& other) {
+        for (auto& [endpoint, values] : other.latencies) {
+            auto& merged = latencies[endpoint];
+            merged.insert(merged.end(), values.begin(), values.end());
+        }
+        for (const auto& [endpoint, count] : other.errors) {
+            errors[endpoint] += count;
+        }
+        lags.insert(lags.end(), other.lags.begin(), other.lags.end());
+    }
+};
+
+// Запрос записи и соединение потока, по которому он уходит
+struct Scheduled {
+    std::uint64_t index;
+    std::size_t connection;
+};
+
+class Worker {
+public:
+    Worker(const Args& args, const http_capture::Capture& capture, Tokens& tokens,
+           const tcp::resolver::results_type& endpoints, std::vector<Scheduled> schedule, std::size_t connections)
+        : args_(args)
+        , capture_(capture)
+        , tokens_(tokens)
+        , schedule_(std::move(schedule)) {
+        clients_.reserve(connections);
+        for (std::size_t i = 0; i < connections; ++i) {
+            clients_.push_back(std::make_unique<Client>(ioc_, endpoints));
+        }
+    }
+
+    Stats Run(Clock::time_point start) {
+        for (const auto& [index, connection] : schedule_) {
+            const auto& captured = capture_.requests[index];
+
+            auto due = start;
+            if (args_.speed > 0) {
+                due += std::chrono::duration_cast<Clock::duration>(captured.time / args_.speed);
+            }
+            std::this_thread::sleep_until(due);
+
+            auto request = MakeRequest(captured);
+            const auto endpoint = EndpointName(captured.target);
+
+            const auto sent = Clock::now();
+            stats_.lags.push_back(std::chrono::duration<double>(sent - due).count());
+            try {
+                const auto response = clients_[connection]->Request(request);
+                stats_.latencies[endpoint].push_back(std::chrono::duration<double>(Clock::now() - sent).count());
+                if (http::to_status_class(response.result()) != http::status_class::successful) {
+                    ++stats_.errors[endpoint];
+                }
+                if (const auto* old_token = tokens_.IssuedBy(index)) {
+                    RememberToken(*old_token, response);
+                }
+            } catch (const std::exception&) {
+                ++stats_.errors[endpoint];
+            }
+        }
+
+        return std::move(stats_);
+    }
+
+private:
+    http::request<http::string_body> MakeRequest(const http_capture::Request& captured) {
+        http::request<http::string_body> request{http::string_to_verb(captured.method), captured.target, 11};
+        for (const auto& [name, value] : captured.headers) {
+            const auto field = http::string_to_field(name);
+            // длина тела и соединение задаются при отправке
+            if (field == http::field::content_length || field == http::field::transfer_encoding
+                || field == http::field::connection) {
+                continue;
+            }
+            if (field == http::field::authorization && value.starts_with(BEARER)) {
+                request.set(field, std::string(BEARER) + tokens_.Lookup(value.substr(BEARER.size())));
+                continue;
+            }
+            request.insert(name, value);
+        }
+        request.keep_alive(true);
+        request.body() = captured.body;
+        request.prepare_payload();
+        return request;
+    }
+
+    void RememberToken(const std::string& old_token, const Client::Response& response) {
+        if (response.result() != http::status::ok) {
+            return;
+        }
+        try {
+            const auto& body = json::parse(response.body()).as_object();
+            tokens_.Replace(old_token, std::string(body.at("authToken").as_string()));
+        } catch (const std::exception&) {
+            // запросы со старым токеном получат 401 и попадут в ошибки
+        }
+    }
+
+    const Args& args_;
+    const http_capture::Capture& capture_;
+    Tokens& tokens_;
+    net::io_context ioc_;
+    std::vector<std::unique_ptr<Client>> clients_;
+    std::vector<Scheduled> schedule_;
+    Stats stats_;
+};
+
+void PrintReport(Stats& stats, std::chrono::duration<double> captured, std::chrono::duration<double> elapsed) {
+    std::size_t width = 10;
+    for (const auto& [endpoint, latencies] : stats.latencies) {
+        width = std::max(width, endpoint.size() + 2);
+    }
+
+    std::cout << std::left << std::setw(static_cast<int>(width)) << "endpoint" << std::right
+              << std::setw(10) << "requests" << std::setw(8) << "errors"
+              << std::setw(10) << "p50, ms" << std::setw(10) << "p99, ms" << std::setw(11) << "p999, ms"
+              << std::setw(10) << "max, ms" << '\n';
+
+    std::uint64_t total = 0;
+    for (auto& [endpoint, latencies] : stats.latencies) {
+        std::sort(latencies.begin(), latencies.end());
+        total += latencies.size();
+
+        std::cout << std::left << std::setw(static_cast<int>(width)) << endpoint << std::right << std::fixed
+                  << std::setw(10) << latencies.size() << std::setw(8) << stats.errors[endpoint]
+                  << std::setprecision(3)
+                  << std::setw(10) << metrics::Percentile(latencies, 0.5) * 1000
+                  << std::setw(10) << metrics::Percentile(latencies, 0.99) * 1000
+                  << std::setw(11) << metrics::Percentile(latencies, 0.999) * 1000
+                  << std::setw(10) << (latencies.empty() ? 0.0 : latencies.back() * 1000) << '\n';
+    }
+
+    std::sort(stats.lags.begin(), stats.lags.end());
+    std::cout << std::setprecision(1) << "total: " << total << " requests in " << elapsed.count()
+              << " s (captured " << captured.count() << " s), "
+              << static_cast<double>(total) / std::max(elapsed.count(), 1e-9) << " req/s\n";
+    // запросы, отправленные позже расписания: клиент или сервер не успевает за скоростью
+    std::cout << std::setprecision(3) << "schedule lag, ms: p50 " << metrics::Percentile(stats.lags, 0.5) * 1000
+              << ", p99 " << metrics::Percentile(stats.lags, 0.99) * 1000
+              << ", max " << (stats.lags.empty() ? 0.0 : stats.lags.back() * 1000) << std::endl;
+}
+
+} // namespace
+
+int main(int argc, const char* argv[]) {
+    try {
+        auto args = ParseCommandLine(argc, argv);
+        if (!args) {
+            return EXIT_SUCCESS;
+        }
+
+        const auto capture = http_capture::ReadCapture(args->capture_file);
+        if (capture.requests.empty()) {
+            std::cout << "capture has no requests" << std::endl;
+            return EXIT_SUCCESS;
+        }
+        Tokens tokens(capture.tokens);
+
+        net::io_context ioc;
+        const auto endpoints = tcp::resolver(ioc).resolve(args->host, args->port);
+
+        // соединения раскладываются по потокам по кругу в порядке первого запроса,
+        // запросы потока идут в порядке записи
+        std::unordered_map<std::string, std::pair<unsigned, std::size_t>> connections;
+        std::vector<std::vector<Scheduled>> schedules(args->threads);
+        std::vector<std::size_t> thread_connections(args->threads);
+        for (std::uint64_t i = 0; i < capture.requests.size(); ++i) {
+            auto [it, inserted] = connections.try_emplace(capture.requests[i].connection);
+            if (inserted) {
+                const auto thread = static_cast<unsigned>((connections.size() - 1) % args->threads);
+                it->second = {thread, thread_connections[thread]++};
+            }
+            const auto [thread, connection] = it->second;
+            schedules[thread].push_back({i, connection});
+        }
+
+        const auto start = Clock::now();
+
+        std::vector<Stats> results(args->threads);
+        {
+            std::vector<std::jthread> threads;
+            for (unsigned i = 0; i < args->threads; ++i) {
+                threads.emplace_back([&, i] {
+                    Worker worker(*args, capture, tokens, endpoints, std::move(schedules[i]), thread_connections[i]);
+                    results[i] = worker.Run(start);
+                });
+            }
+        }
+        const auto elapsed = Clock::now() - start;
+
+        Stats total;
+        for (auto& stats : results) {
+            total.Merge(std::move(stats));
+        }
+        std::cout << capture.requests.size() << " requests over " << connections.size() << " connections, speed ";
+        if (args->speed > 0) {
+            std::cout << args->speed << "x\n";
+        } else {
+            std::cout << "max\n";
+        }
+        PrintReport(total, capture.requests.back().time, elapsed);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include <utility>
+
+namespace http_client {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+// Одно синхронное keep-alive соединение с сервером для инструментов нагрузки.
+// При разрыве переподключается и повторяет запрос один раз
+class Client {
+public:
+    using Response = http::response<http::string_body>;
+
+    Client(net::io_context& ioc, tcp::resolver::results_type endpoints)
+        : stream_(ioc)
+        , endpoints_(std::move(endpoints)) {
+    }
+
+    Response Request(const http::request<http::string_body>& request) {
+        // соединение, закрытое сервером, обнаруживается только при записи или чтении
+        for (int attempt = 0;; ++attempt) {
+            try {
+                if (!connected_) {
+                    stream_.connect(endpoints_);
+                    // без задержки Нагла маленькие запросы уходят сразу и не искажают задержку
+                    stream_.socket().set_option(tcp::no_delay(true));
+                    connected_ = true;
+                }
+                http::write(stream_, request);
+                Response response;
+                http::read(stream_, buffer_, response);
+                if (!response.keep_alive()) {
+                    Close();
+                }
+                return response;
+            } catch (const boost::system::system_error&) {
+                Close();
+                if (attempt > 0) {
+                    throw;
+                }
+            }
+        }
+    }
+
+private:
+    void Close() {
+        beast::error_code ec;
+        stream_.socket().shutdown(tcp::socket::shutdown_both, ec);
+        stream_.close();
+        buffer_.clear();
+        connected_ = false;
+    }
+
+    beast::tcp_stream stream_;
+    tcp::resolver::results_type endpoints_;
+    beast::flat_buffer buffer_;
+    bool connected_ = false;
+};
+
+}  // namespace http_client
@@ -0,0 +1,47 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "json_loader.h"
+#include "map_pack.h"
+
+// Переводит config.json в двоичный набор карт, который сервер загружает через mmap:
+//   map_compiler <config.json> <maps.pack>
+int main(int argc, const char* argv[]) {
+    namespace fs = std::filesystem;
+
+    if (argc != 3) {
+        std::cerr << "Usage: map_compiler <config.json> <maps.pack>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const fs::path config_path(argv[1]);
+        const fs::path pack_path(argv[2]);
+
+        const model::Game game = json_loader::LoadGame(config_path);
+        const std::string data = map_pack::MapPack::Encode(game);
+
+        // проверяем, что набор читается обратно
+        map_pack::MapPack::Decode(data);
+
+        fs::path temp_path(pack_path);
+        temp_path += ".tmp";
+        {
+            std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+            if (!out.write(data.data(), static_cast<std::streamsize>(data.size()))) {
+                throw std::runtime_error("Cannot write " + temp_path.string());
+            }
+        }
+        fs::rename(temp_path, pack_path);
+
+        std::cout << "Compiled " << game.GetMaps().size() << " maps into " << pack_path.string()
+                  << " (" << data.size() << " bytes)" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
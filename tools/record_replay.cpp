@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <variant>
+#include <vector>
+
+#include "json_loader.h"
+#include "map_pack.h"
+#include "metrics.h"
+#include "recording.h"
+#include "state_format.h"
+
+// Воспроизводит запись сеанса (game_server --record) поверх той же конфигурации
+// и начального состояния, сверяет хеш итогового состояния и печатает время:
+//   record_replay <recording>
+// Код возврата 2 - итоговое состояние разошлось с записанным
+int main(int argc, const char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: record_replay <recording>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const auto recording = recording::ReadRecording(argv[1]);
+
+        model::Game game = map_pack::MapPack::IsMapPack(recording.config)
+            ? map_pack::MapPack::Decode(recording.config)
+            : json_loader::ParseGame(recording.config);
+        game.RestoreState(serialization::BinaryStateFormat::Decode(recording.initial_state));
+        recording::RestoreIdCounters(recording.counters);
+
+        auto dogs = game.IndexDogs();
+
+        std::size_t joins = 0;
+        std::size_t moves = 0;
+        std::vector<double> tick_times;
+        std::chrono::milliseconds virtual_time{0};
+
+        const auto start = metrics::Clock::now();
+        for (const auto& [time, event] : recording.events) {
+            if (const auto* tick = std::get_if<journal::TickEvent>(&event)) {
+                metrics::Stopwatch stopwatch;
+                game.ReplayEvent(event, dogs);
+                tick_times.push_back(std::chrono::duration<double>(stopwatch.Lap()).count());
+                virtual_time += std::chrono::milliseconds(tick->delta);
+                continue;
+            }
+            joins += std::holds_alternative<journal::JoinEvent>(event);
+            moves += std::holds_alternative<journal::MoveEvent>(event);
+            game.ReplayEvent(event, dogs);
+        }
+        const std::chrono::duration<double> elapsed = metrics::Clock::now() - start;
+
+        const auto recorded = recording.events.empty()
+            ? std::chrono::duration<double>(0)
+            : std::chrono::duration<double>(recording.events.back().time);
+
+        double total_tick_time = 0;
+        for (double time : tick_times) {
+            total_tick_time += time;
+        }
+        std::sort(tick_times.begin(), tick_times.end());
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "events: " << recording.events.size() << " (joins " << joins << ", moves " << moves
+                  << ", ticks " << tick_times.size() << ")\n";
+        std::cout << "recorded: " << recorded.count() << " s wall, "
+                  << std::chrono::duration<double>(virtual_time).count() << " s game time\n";
+        std::cout << "replayed in " << elapsed.count() << " s";
+        if (elapsed.count() > 0) {
+            std::cout << ", " << std::setprecision(1) << static_cast<double>(tick_times.size()) / elapsed.count()
+                      << " ticks/s";
+        }
+        std::cout << '\n' << std::setprecision(3);
+        if (!tick_times.empty()) {
+            std::cout << "tick, ms: mean " << total_tick_time / tick_times.size() * 1000
+                      << ", p50 " << metrics::Percentile(tick_times, 0.5) * 1000
+                      << ", p99 " << metrics::Percentile(tick_times, 0.99) * 1000
+                      << ", max " << tick_times.back() * 1000 << '\n';
+        }
+
+        const auto hash = recording::StateHash(game);
+        std::cout << "state hash: " << std::hex << std::setw(16) << std::setfill('0') << hash << std::dec << '\n';
+
+        if (!recording.final_state_hash) {
+            std::cout << "recording has no final state hash (server did not stop cleanly)" << std::endl;
+        } else if (*recording.final_state_hash != hash) {
+            std::cout << "MISMATCH: recorded state hash " << std::hex << std::setw(16) << std::setfill('0')
+                      << *recording.final_state_hash << std::dec << std::endl;
+            return 2;
+        } else {
+            std::cout << "state matches the recording" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}